@@ -12,6 +12,7 @@
 #include "memlib.h"
 #include "mm.h"
 #include "mminline.h"
+#include "mmzone.h"
 
 /**********************
  * Constants and macros
@@ -25,8 +26,8 @@
     (i + 5) /* cnvt trace request nums to linenums (origin 1) \
              */
 
-/* Returns true if p is ALIGNMENT-byte aligned */
-#define IS_ALIGNED(p) ((((unsigned long)(p)) % ALIGNMENT) == 0)
+/* Returns true if p is a-byte aligned */
+#define IS_ALIGNED(p, a) ((((unsigned long)(p)) % (a)) == 0)
 
 /******************************
  * The key compound data types
@@ -41,9 +42,10 @@ typedef struct range_t {
 
 /* Characterizes a single trace operation (allocator request) */
 typedef struct {
-    enum { ALLOC, FREE, REALLOC } type; /* type of request */
-    int index;                          /* index for free() to use later */
-    int size;                           /* byte size of alloc/realloc request */
+    enum { ALLOC, FREE, REALLOC, MEMALIGN, CALLOC } type; /* request type */
+    int index;     /* index for free() to use later */
+    int size;      /* byte size of alloc/realloc request */
+    int alignment; /* payload alignment; ALIGNMENT but for memalign */
 } traceop_t;
 
 /* Holds the information for one trace file*/
@@ -66,6 +68,7 @@ typedef struct {
 typedef struct {
     trace_t *trace;
     range_t *ranges;
+    int *ids; /* eval_free_speed: ids allocated since the last reset */
 } speed_t;
 
 /* Summarizes the important stats for some malloc function on some trace */
@@ -81,6 +84,9 @@ typedef struct {
 
     /* defined only for the student malloc package */
     double util; /* space utilization for this trace (always 0 for libc) */
+    size_t heap;      /* heap and mapped bytes at the end of the trace */
+    size_t heap_peak; /* their high-water marks during the trace, summed */
+    mm_counters_t counters; /* mm_get_counters at the end of the trace */
 
     /* Note: secs and util are only defined if valid is true */
 } stats_t;
@@ -95,6 +101,9 @@ char msg[MAXLINE + 100];     /* for whenever we need to compose an error message
 /* Directory where default tracefiles are found */
 static char tracedir[MAXLINE] = TRACEDIR;
 
+/* Ops between resets in the zone comparison (-z), 0 if not run */
+static int zone_ops = 0;
+
 /* The filenames of the default tracefiles */
 static char *default_tracefiles[] = {DEFAULT_TRACEFILES, NULL};
 
@@ -103,8 +112,8 @@ static char *default_tracefiles[] = {DEFAULT_TRACEFILES, NULL};
  *********************/
 
 /* these functions manipulate range lists */
-static int add_range(range_t **ranges, char *lo, int size, int tracenum,
-                     int opnum);
+static int add_range(range_t **ranges, char *lo, int size, int alignment,
+                     int tracenum, int opnum);
 static void remove_range(range_t **ranges, char *lo);
 static void clear_ranges(range_t **ranges);
 
@@ -121,12 +130,17 @@ static void eval_libc_speed(void *ptr);
 static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges);
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges);
 static void eval_mm_speed(void *ptr);
+static void eval_free_speed(void *ptr);
+static void eval_zone_speed(void *ptr);
 
 /* Various helper routines */
 static double compute_performance_index(int num_tracefiles, double secs,
                                         double ops, double util);
 static void printresults(int n, stats_t *stats);
+static void printcounters(int n, stats_t *stats);
 static void printpassed(int n, stats_t *stats);
+static void printfitmatrix(char **tracefiles, int n);
+static void printzones(char **tracefiles, int n);
 static void printresultsgradescope(int n, stats_t *stats);
 
 static void usage(void);
@@ -154,6 +168,7 @@ int main(int argc, char **argv) {
     int run_libc = 0;   /* If set, run libc malloc (set by -l) */
     int autograder = 0; /* If set, emit summary info for autograder (-g) */
     int gradescope = 0;
+    int fit_matrix = 0; /* If set, compare placement policies (-P) */
     /* temporaries used to compute the performance index */
     double secs, ops, util, perfindex;
     int numcorrect;
@@ -162,7 +177,7 @@ int main(int argc, char **argv) {
      * Read and interpret the command line arguments
      */
 
-    while ((c = getopt(argc, argv, "f:t:hvVgGalr")) != EOF) {
+    while ((c = getopt(argc, argv, "d:f:F:i:o:p:s:t:z:hvVgGalPr")) != EOF) {
         switch (c) {
             case 'r': /* start repl */
                 driver();
@@ -183,6 +198,73 @@ int main(int argc, char **argv) {
                 tracefiles[0] = strdup(optarg);
                 tracefiles[1] = NULL;
                 break;
+            case 'i': /* Free block index used by mm_malloc */
+                if (!strcmp(optarg, "seglist")) {
+                    mm_set_index(MM_INDEX_SEGLIST);
+                } else if (!strcmp(optarg, "tlsf")) {
+                    mm_set_index(MM_INDEX_TLSF);
+                } else {
+                    usage();
+                    exit(1);
+                }
+                break;
+            case 'F': /* Placement policy for the segregated lists */
+                if (!strcmp(optarg, "first")) {
+                    mm_set_fit(MM_FIT_FIRST);
+                } else if (!strcmp(optarg, "next")) {
+                    mm_set_fit(MM_FIT_NEXT);
+                } else if (!strcmp(optarg, "best")) {
+                    mm_set_fit(MM_FIT_BEST);
+                } else if (!strcmp(optarg, "good")) {
+                    mm_set_fit(MM_FIT_GOOD);
+                } else {
+                    usage();
+                    exit(1);
+                }
+                break;
+            case 'o': /* Order of the segregated lists */
+                if (!strcmp(optarg, "lifo")) {
+                    mm_set_order(MM_ORDER_LIFO);
+                } else if (!strcmp(optarg, "address")) {
+                    mm_set_order(MM_ORDER_ADDRESS);
+                } else {
+                    usage();
+                    exit(1);
+                }
+                break;
+            case 'p': /* Carve small blocks from the end of free blocks */
+                if (!strcmp(optarg, "on")) {
+                    mm_set_split(1);
+                } else if (!strcmp(optarg, "off")) {
+                    mm_set_split(0);
+                } else {
+                    usage();
+                    exit(1);
+                }
+                break;
+            case 'P': /* Compare every placement policy */
+                fit_matrix = 1;
+                break;
+            case 's': /* Serve small requests from slab runs */
+                if (!strcmp(optarg, "on")) {
+                    mm_set_slab(1);
+                } else if (!strcmp(optarg, "off")) {
+                    mm_set_slab(0);
+                } else {
+                    usage();
+                    exit(1);
+                }
+                break;
+            case 'd': /* Defer coalescing of freed blocks */
+                if (!strcmp(optarg, "on")) {
+                    mm_set_deferred(1);
+                } else if (!strcmp(optarg, "off")) {
+                    mm_set_deferred(0);
+                } else {
+                    usage();
+                    exit(1);
+                }
+                break;
             case 't': /* Directory where the traces are located */
                 if (num_tracefiles == 1) /* ignore if -f already encountered */
                     break;
@@ -190,6 +272,13 @@ int main(int argc, char **argv) {
                 if (tracedir[strlen(tracedir) - 1] != '/')
                     strcat(tracedir, "/"); /* path always ends with "/" */
                 break;
+            case 'z': /* Compare zone resets with per-object frees */
+                zone_ops = atoi(optarg);
+                if (zone_ops <= 0) {
+                    usage();
+                    exit(1);
+                }
+                break;
             case 'l': /* Run libc malloc */
                 run_libc = 1;
                 break;
@@ -266,6 +355,15 @@ int main(int argc, char **argv) {
     /* Initialize the simulated memory system in memlib.c */
     mem_init();
 
+    if (fit_matrix) {
+        printfitmatrix(tracefiles, num_tracefiles);
+        exit(0);
+    }
+    if (zone_ops) {
+        printzones(tracefiles, num_tracefiles);
+        exit(0);
+    }
+
     /* Evaluate student's mm malloc package using the K-best scheme */
     for (i = 0; i < num_tracefiles; i++) {
         trace = read_trace(tracedir, tracefiles[i]);
@@ -289,6 +387,7 @@ int main(int argc, char **argv) {
         printf("\nResults for mm malloc:\n");
         printresults(num_tracefiles, mm_stats);
         printf("\n");
+        printcounters(num_tracefiles, mm_stats);
     }
 
     if (gradescope) {
@@ -340,11 +439,12 @@ int main(int argc, char **argv) {
 /*
  * add_range - As directed by request opnum in trace tracenum,
  *     we've just called the student's mm_malloc to allocate a block of
- *     size bytes at addr lo. After checking the block for correctness,
- *     we create a range struct for this block and add it to the range list.
+ *     size bytes at addr lo, aligned to alignment bytes. After checking the
+ *     block for correctness, we create a range struct for this block and
+ *     add it to the range list.
  */
-static int add_range(range_t **ranges, char *lo, int size, int tracenum,
-                     int opnum) {
+static int add_range(range_t **ranges, char *lo, int size, int alignment,
+                     int tracenum, int opnum) {
   if (!size) return 1;
 
   char *hi = lo + size - 1;
@@ -353,17 +453,20 @@ static int add_range(range_t **ranges, char *lo, int size, int tracenum,
 
     assert(size > 0);
 
-    /* Payload addresses must be ALIGNMENT-byte aligned */
-    if (!IS_ALIGNED(lo)) {
+    /* Payload addresses must be ALIGNMENT-byte aligned, or aligned as
+     * mm_memalign was asked */
+    if (!IS_ALIGNED(lo, alignment)) {
         sprintf(msg, "Payload address (%p) not aligned to %d bytes", lo,
-                ALIGNMENT);
+                alignment);
         malloc_error(tracenum, opnum, msg);
         return 0;
     }
 
-    /* The payload must lie within the extent of the heap */
-    if ((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) ||
-        (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) {
+    /* The payload must lie within the extent of the heap, or of one of
+     * the mappings memlib handed out */
+    if (((lo < (char *)mem_heap_lo()) || (lo > (char *)mem_heap_hi()) ||
+         (hi < (char *)mem_heap_lo()) || (hi > (char *)mem_heap_hi())) &&
+        !mem_mapped(lo, hi)) {
         sprintf(msg, "Payload (%p:%p) lies outside heap (%p:%p)", lo, hi,
                 mem_heap_lo(), mem_heap_hi());
         malloc_error(tracenum, opnum, msg);
@@ -443,7 +546,7 @@ static trace_t *read_trace(char *tracedir, char *filename) {
   trace_t *trace;
   char type[MAXLINE];
   char path[MAXLINE];
-  unsigned index, size;
+  unsigned index, size, alignment;
   unsigned max_index = 0;
   unsigned op_index;
 
@@ -491,6 +594,7 @@ static trace_t *read_trace(char *tracedir, char *filename) {
         trace->ops[op_index].type = ALLOC;
         trace->ops[op_index].index = index;
         trace->ops[op_index].size = size;
+        trace->ops[op_index].alignment = ALIGNMENT;
         max_index = (index > max_index) ? index : max_index;
         break;
       case 'r':
@@ -498,6 +602,23 @@ static trace_t *read_trace(char *tracedir, char *filename) {
         trace->ops[op_index].type = REALLOC;
         trace->ops[op_index].index = index;
         trace->ops[op_index].size = size;
+        trace->ops[op_index].alignment = ALIGNMENT;
+        max_index = (index > max_index) ? index : max_index;
+        break;
+      case 'c':
+        _check(fscanf(tracefile, "%u %u", &index, &size));
+        trace->ops[op_index].type = CALLOC;
+        trace->ops[op_index].index = index;
+        trace->ops[op_index].size = size;
+        trace->ops[op_index].alignment = ALIGNMENT;
+        max_index = (index > max_index) ? index : max_index;
+        break;
+      case 'm':
+        _check(fscanf(tracefile, "%u %u %u", &index, &size, &alignment));
+        trace->ops[op_index].type = MEMALIGN;
+        trace->ops[op_index].index = index;
+        trace->ops[op_index].size = size;
+        trace->ops[op_index].alignment = alignment;
         max_index = (index > max_index) ? index : max_index;
         break;
       case 'f':
@@ -563,9 +684,17 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) {
 
         switch (trace->ops[i].type) {
             case ALLOC: /* mm_malloc */
+            case MEMALIGN: /* mm_memalign */
+            case CALLOC: /* mm_calloc */
 
                 /* Call the student's malloc */
-                if ((p = mm_malloc(size)) == NULL && size) {
+                if (trace->ops[i].type == MEMALIGN)
+                    p = mm_memalign(trace->ops[i].alignment, size);
+                else if (trace->ops[i].type == CALLOC)
+                    p = mm_calloc(1, size);
+                else
+                    p = mm_malloc(size);
+                if (p == NULL && size) {
                     malloc_error(tracenum, i, "mm_malloc failed.");
                     return 0;
                 } else if (!size) {
@@ -578,7 +707,37 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) {
                  * to the range list if OK. The block must be  be aligned
                  * properly, and must not overlap any currently allocated block.
                  */
-                if (add_range(ranges, p, size, tracenum, i) == 0) return 0;
+                if (add_range(ranges, p, size, trace->ops[i].alignment,
+                              tracenum, i) == 0)
+                    return 0;
+
+                /* A size that overflows the search must fail */
+                if (trace->ops[i].type == MEMALIGN &&
+                    mm_memalign(trace->ops[i].alignment, SIZE_MAX - 16) !=
+                        NULL) {
+                    malloc_error(tracenum, i,
+                                 "mm_memalign did not fail on a size that "
+                                 "overflows");
+                    return 0;
+                }
+
+                /* A calloc'd payload must read as zero */
+                if (trace->ops[i].type == CALLOC) {
+                    if (mm_calloc(1, SIZE_MAX) != NULL ||
+                        mm_calloc(SIZE_MAX / 2 + 1, 2) != NULL) {
+                        malloc_error(tracenum, i,
+                                     "mm_calloc did not fail on a size that "
+                                     "overflows");
+                        return 0;
+                    }
+                    for (j = 0; j < size; j++) {
+                        if (p[j] != 0) {
+                            malloc_error(tracenum, i,
+                                         "mm_calloc did not zero the block");
+                            return 0;
+                        }
+                    }
+                }
 
                 /* ADDED: cgw
                  * fill range with low byte of index.  This will be used later
@@ -596,6 +755,14 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) {
 
                 /* Call the student's realloc */
                 oldp = trace->blocks[index];
+                /* A size that cannot be mapped must fail and leave the old
+                 * block alone, which the data check below verifies */
+                if (mm_realloc(oldp, SIZE_MAX) != NULL) {
+                    malloc_error(tracenum, i,
+                                 "mm_realloc did not fail on a size that "
+                                 "overflows");
+                    return 0;
+                }
                 if ((newp = mm_realloc(oldp, size)) == NULL && size) {
                     malloc_error(tracenum, i, "mm_realloc failed.");
                     return 0;
@@ -609,7 +776,8 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) {
                 remove_range(ranges, oldp);
 
                 /* Check new block for correctness and add it to range list */
-                if (add_range(ranges, newp, size, tracenum, i) == 0) return 0;
+                if (add_range(ranges, newp, size, ALIGNMENT, tracenum, i) == 0)
+                    return 0;
 
                 /* ADDED: cgw
                  * Make sure that the new block contains the data from the old
@@ -655,10 +823,11 @@ static int eval_mm_valid(trace_t *trace, int tracenum, range_t **ranges) {
  *   The idea is to remember the high water mark "hwm" of the heap for
  *   an optimal allocator, i.e., no gaps and no internal fragmentation.
  *   Utilization is the ratio hwm/heapsize, where heapsize is the
- *   size of the heap in bytes after running the student's malloc
- *   package on the trace. Note that our implementation of mem_sbrk()
- *   doesn't allow the students to decrement the brk pointer, so brk
- *   is always the high water mark of the heap.
+ *   high water mark of the heap in bytes while running the student's
+ *   malloc package on the trace, plus that of the bytes it mapped with
+ *   mem_map(). mem_sbrk() lets the package decrement the brk pointer, so
+ *   this can be more than the size of the heap at the end of the trace;
+ *   both are recorded in mm_stats.
  *
  */
 static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges) {
@@ -683,10 +852,18 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges) {
 
         switch (trace->ops[i].type) {
             case ALLOC: /* mm_alloc */
+            case MEMALIGN: /* mm_memalign */
+            case CALLOC: /* mm_calloc */
                 index = trace->ops[i].index;
                 size = trace->ops[i].size;
 
-                if ((p = mm_malloc(size)) == NULL && size) {
+                if (trace->ops[i].type == MEMALIGN)
+                    p = mm_memalign(trace->ops[i].alignment, size);
+                else if (trace->ops[i].type == CALLOC)
+                    p = mm_calloc(1, size);
+                else
+                    p = mm_malloc(size);
+                if (p == NULL && size) {
                     app_error("mm_malloc failed in eval_mm_util");
                 } else if (!size) {
                     // since we already checked that the return value should be 0,
@@ -696,7 +873,9 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges) {
 
                 /* Still need to memset, because otherwise there's no guarantee
                  * the space is usable */
-                if (add_range(ranges, p, size, tracenum, i) == 0) return 0;
+                if (add_range(ranges, p, size, trace->ops[i].alignment,
+                              tracenum, i) == 0)
+                    return 0;
                 memset(p, index & 0xFF, size);
 
                 /* Remember region and size */
@@ -728,7 +907,8 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges) {
                 /* Still need to memset and check region integrity */
                 remove_range(ranges, oldp);
 
-                if (add_range(ranges, newp, size, tracenum, i) == 0) return 0;
+                if (add_range(ranges, newp, size, ALIGNMENT, tracenum, i) == 0)
+                    return 0;
 
                 memset(newp, index & 0xFF, size);
 
@@ -765,7 +945,10 @@ static double eval_mm_util(trace_t *trace, int tracenum, range_t **ranges) {
         }
     }
 
-    return ((double)max_total_size / (double)mem_heapsize());
+    mm_get_counters(&mm_stats[tracenum].counters);
+    mm_stats[tracenum].heap = mem_heapsize() + mem_mapsize();
+    mm_stats[tracenum].heap_peak = mem_heapsize_peak() + mem_mapsize_peak();
+    return ((double)max_total_size / (double)mm_stats[tracenum].heap_peak);
 }
 
 /*
@@ -795,6 +978,19 @@ static void eval_mm_speed(void *ptr) {
                 trace->blocks[index] = p;
                 break;
 
+            case MEMALIGN: /* mm_memalign */
+                if ((p = mm_memalign(trace->ops[i].alignment, size)) == NULL)
+                    app_error("mm_memalign error in eval_mm_speed");
+                memset(p, index & 0xFF, size);
+                trace->blocks[index] = p;
+                break;
+
+            case CALLOC: /* mm_calloc, which writes what it has to itself */
+                if ((p = mm_calloc(1, size)) == NULL)
+                    app_error("mm_calloc error in eval_mm_speed");
+                trace->blocks[index] = p;
+                break;
+
             case REALLOC: /* mm_realloc */
                 index = trace->ops[i].index;
                 newsize = trace->ops[i].size;
@@ -817,6 +1013,97 @@ static void eval_mm_speed(void *ptr) {
     }
 }
 
+/*
+ * eval_free_speed - replays a trace with mm_malloc and mm_free as if the
+ *    program's objects all died every zone_ops requests: at that point every
+ *    block still allocated is freed, one mm_free at a time, and later frees
+ *    of those blocks are dropped. This is the baseline that eval_zone_speed
+ *    is compared with. Only traces of mallocs and frees are replayed.
+ */
+static void eval_free_speed(void *ptr) {
+    int i, index, size, nids = 0;
+    char *p;
+    trace_t *trace = ((speed_t *)ptr)->trace;
+    int *ids = ((speed_t *)ptr)->ids;
+
+    mem_reset_brk();
+    if (mm_init() < 0) app_error("mm_init failed in eval_free_speed");
+    memset(trace->blocks, 0, trace->num_ids * sizeof(char *));
+
+    for (i = 0; i < trace->num_ops; i++) {
+        if (i > 0 && i % zone_ops == 0) {
+            for (; nids > 0; nids--) {
+                index = ids[nids - 1];
+                if (trace->blocks[index] != NULL) {
+                    mm_free(trace->blocks[index]);
+                    trace->blocks[index] = NULL;
+                }
+            }
+        }
+        index = trace->ops[i].index;
+        size = trace->ops[i].size;
+        switch (trace->ops[i].type) {
+            case ALLOC:
+                if ((p = mm_malloc(size)) == NULL && size)
+                    app_error("mm_malloc error in eval_free_speed");
+                memset(p, index & 0xFF, size);
+                trace->blocks[index] = p;
+                ids[nids++] = index;
+                break;
+
+            case FREE:
+                if (trace->blocks[index] != NULL) {
+                    mm_free(trace->blocks[index]);
+                    trace->blocks[index] = NULL;
+                }
+                break;
+
+            case REALLOC:
+            case MEMALIGN:
+            case CALLOC:
+                break;
+        }
+    }
+}
+
+/*
+ * eval_zone_speed - replays a trace through a zone, resetting it every
+ *    zone_ops requests: blocks come from mm_zone_alloc and frees do
+ *    nothing. Only traces of mallocs and frees are replayed.
+ */
+static void eval_zone_speed(void *ptr) {
+    int i, index, size;
+    char *p;
+    trace_t *trace = ((speed_t *)ptr)->trace;
+    mm_zone_t *zone;
+
+    mem_reset_brk();
+    if (mm_init() < 0) app_error("mm_init failed in eval_zone_speed");
+    if ((zone = mm_zone_create()) == NULL)
+        app_error("mm_zone_create failed in eval_zone_speed");
+
+    for (i = 0; i < trace->num_ops; i++) {
+        if (i > 0 && i % zone_ops == 0) {
+            mm_zone_reset(zone);
+        }
+        index = trace->ops[i].index;
+        size = trace->ops[i].size;
+        switch (trace->ops[i].type) {
+            case ALLOC:
+                if ((p = mm_zone_alloc(zone, size)) == NULL && size)
+                    app_error("mm_zone_alloc error in eval_zone_speed");
+                memset(p, index & 0xFF, size);
+                break;
+
+            case FREE:
+            case REALLOC:
+            case MEMALIGN:
+            case CALLOC:
+                break;
+        }
+    }
+}
+
 /*
  * eval_libc_valid - We run this function to make sure that the
  *    libc malloc can run to completion on the set of traces.
@@ -837,6 +1124,23 @@ static int eval_libc_valid(trace_t *trace, int tracenum) {
                 trace->blocks[trace->ops[i].index] = p;
                 break;
 
+            case MEMALIGN: /* posix_memalign */
+                if (posix_memalign((void **)&p, trace->ops[i].alignment,
+                                   trace->ops[i].size) != 0) {
+                    malloc_error(tracenum, i, "libc posix_memalign failed");
+                    unix_error("System message");
+                }
+                trace->blocks[trace->ops[i].index] = p;
+                break;
+
+            case CALLOC: /* calloc */
+                if ((p = calloc(1, trace->ops[i].size)) == NULL) {
+                    malloc_error(tracenum, i, "libc calloc failed");
+                    unix_error("System message");
+                }
+                trace->blocks[trace->ops[i].index] = p;
+                break;
+
             case REALLOC: /* realloc */
                 newsize = trace->ops[i].size;
                 oldp = trace->blocks[trace->ops[i].index];
@@ -880,6 +1184,21 @@ static void eval_libc_speed(void *ptr) {
                 trace->blocks[index] = p;
                 break;
 
+            case MEMALIGN: /* posix_memalign */
+                index = trace->ops[i].index;
+                if (posix_memalign((void **)&p, trace->ops[i].alignment,
+                                   trace->ops[i].size) != 0)
+                    unix_error("posix_memalign failed in eval_libc_speed");
+                trace->blocks[index] = p;
+                break;
+
+            case CALLOC: /* calloc */
+                index = trace->ops[i].index;
+                if ((p = calloc(1, trace->ops[i].size)) == NULL)
+                    unix_error("calloc failed in eval_libc_speed");
+                trace->blocks[index] = p;
+                break;
+
             case REALLOC: /* realloc */
                 index = trace->ops[i].index;
                 newsize = trace->ops[i].size;
@@ -937,18 +1256,25 @@ static void printresults(int n, stats_t *stats) {
     double util = 0;
 
     /* Print the individual results for each trace */
-    printf("%6s %4s                %12s %6s%5s%8s%11s\n", "trace#", " name",
-           " consistent", "util", "ops", "secs", "Kops");
+    printf("%6s %4s                %12s %6s%5s%8s%11s%9s%9s\n", "trace#",
+           " name", " consistent", "util", "ops", "secs", "Kops", "heap KB",
+           "peak KB");
     printf(
         "----------------------------------------------------------------------"
-        "-"
+        "-------------------"
         "\n");
     for (i = 0; i < n; i++) {
         if (stats[i].valid) {
-            printf(" %-2d     %-19s   %-9s%5.1f%%%8.0f%10.6f%8.0f\n", i,
+            printf(" %-2d     %-19s   %-9s%5.1f%%%8.0f%10.6f%8.0f", i,
                    stats[i].trace_name, "yes", stats[i].util * 100.0,
                    stats[i].ops, stats[i].secs,
                    (stats[i].ops / 1e3) / stats[i].secs);
+            if (stats[i].heap_peak > 0) {
+                printf("%9.1f%9.1f\n", stats[i].heap / 1024.0,
+                       stats[i].heap_peak / 1024.0);
+            } else {
+                printf("%9s%9s\n", "-", "-");
+            }
             secs += stats[i].secs;
             ops += stats[i].ops;
             util += stats[i].util;
@@ -968,6 +1294,126 @@ static void printresults(int n, stats_t *stats) {
     }
 }
 
+/*
+ * printfitmatrix - runs the n traces under every placement policy and free
+ *     list order, and prints the average utilization and the throughput of
+ *     each combination
+ */
+static void printfitmatrix(char **tracefiles, int n) {
+    static const struct {
+        const char *name;
+        mm_fit_t fit;
+    } fits[] = {{"first", MM_FIT_FIRST},
+                {"next", MM_FIT_NEXT},
+                {"best", MM_FIT_BEST},
+                {"good", MM_FIT_GOOD}};
+    static const struct {
+        const char *name;
+        mm_order_t order;
+    } orders[] = {{"lifo", MM_ORDER_LIFO}, {"address", MM_ORDER_ADDRESS}};
+    range_t *ranges = NULL;
+    speed_t speed_params;
+    int i, f, o;
+
+    printf("%-8s%-10s%8s%10s\n", "fit", "order", "util", "Kops");
+    printf("------------------------------------\n");
+    for (f = 0; f < (int)(sizeof(fits) / sizeof(fits[0])); f++) {
+        for (o = 0; o < (int)(sizeof(orders) / sizeof(orders[0])); o++) {
+            double secs = 0, ops = 0, util = 0;
+            int valid = 1;
+            mm_set_fit(fits[f].fit);
+            mm_set_order(orders[o].order);
+            for (i = 0; i < n && valid; i++) {
+                trace_t *trace = read_trace(tracedir, tracefiles[i]);
+                strncpy(mm_stats[i].trace_name, trace->trace_name, MAXLINE);
+                valid = eval_mm_valid(trace, i, &ranges);
+                if (valid) {
+                    util += eval_mm_util(trace, i, &ranges);
+                    speed_params.trace = trace;
+                    speed_params.ranges = ranges;
+                    secs += fsecs(eval_mm_speed, &speed_params);
+                    ops += trace->num_ops;
+                }
+                free_trace(trace);
+            }
+            if (valid) {
+                printf("%-8s%-10s%7.1f%%%10.0f\n", fits[f].name,
+                       orders[o].name, util / n * 100.0, ops / 1e3 / secs);
+            } else {
+                printf("%-8s%-10s%8s%10s\n", fits[f].name, orders[o].name,
+                       "-", "-");
+            }
+        }
+    }
+    clear_ranges(&ranges);
+}
+
+/*
+ * printzones - for each of the n traces, prints the throughput of replaying
+ *     it with per-object frees of every block alive at each zone_ops-request
+ *     boundary (eval_free_speed) and with a zone reset there instead
+ *     (eval_zone_speed), and the peak heap of each
+ */
+static void printzones(char **tracefiles, int n) {
+    speed_t speed_params;
+    int i;
+
+    printf("Objects die every %d requests\n", zone_ops);
+    printf("%6s %4s                %10s%10s%9s%14s%14s\n", "trace#", " name",
+           "free Kops", "zone Kops", "speedup", "free peak KB",
+           "zone peak KB");
+    for (i = 0; i < n; i++) {
+        trace_t *trace = read_trace(tracedir, tracefiles[i]);
+        int j, others = 0;
+        for (j = 0; j < trace->num_ops; j++)
+            others += trace->ops[j].type != ALLOC && trace->ops[j].type != FREE;
+        if (others) {
+            printf(" %-2d     %-19s   skipped, not just mallocs and frees\n",
+                   i, trace->trace_name);
+            free_trace(trace);
+            continue;
+        }
+        if ((speed_params.ids = malloc(trace->num_ops * sizeof(int))) == NULL)
+            unix_error("malloc failed in printzones");
+        speed_params.trace = trace;
+        speed_params.ranges = NULL;
+        double free_secs = fsecs(eval_free_speed, &speed_params);
+        size_t free_peak = mem_heapsize_peak() + mem_mapsize_peak();
+        double zone_secs = fsecs(eval_zone_speed, &speed_params);
+        size_t zone_peak = mem_heapsize_peak() + mem_mapsize_peak();
+        printf(" %-2d     %-19s   %10.0f%10.0f%8.2fx%14.1f%14.1f\n", i,
+               trace->trace_name, trace->num_ops / 1e3 / free_secs,
+               trace->num_ops / 1e3 / zone_secs, free_secs / zone_secs,
+               free_peak / 1024.0, zone_peak / 1024.0);
+        free(speed_params.ids);
+        free_trace(trace);
+    }
+}
+
+/*
+ * printcounters - prints, for each trace, how many payload bytes mm_realloc
+ * copied and how many it saved copying, and the most free blocks a single
+ * search looked at
+ */
+static void printcounters(int n, stats_t *stats) {
+    int i;
+    int header = 0;
+
+    for (i = 0; i < n; i++) {
+        mm_counters_t *c = &stats[i].counters;
+        if (!stats[i].valid) continue;
+        if (!header) {
+            printf("%6s %4s                %16s%16s%16s\n", "trace#", " name",
+                   "realloc copied", "copies saved", "longest search");
+            header = 1;
+        }
+        printf(" %-2d     %-19s   %13.1f KB%13.1f KB%16u\n", i,
+               stats[i].trace_name, c->realloc_copied / 1024.0,
+               c->realloc_saved / 1024.0, c->search_max);
+    }
+    if (header) printf("\n");
+}
+
 static void printresultsgradescope(int n, stats_t *stats) {
     int i;
     double util = 0;
@@ -1076,9 +1522,28 @@ void malloc_error(int tracenum, int opnum, char *msg) {
  * usage - Explain the command line arguments
  */
 static void usage(void) {
-    fprintf(stderr, "Usage: mdriver [-hvValr] [-f <file>] [-t <dir>]\n");
+    fprintf(stderr,
+            "Usage: mdriver [-hvValPr] [-d <on|off>] [-f <file>] [-F <fit>] "
+            "[-i <index>] [-o <order>] [-p <on|off>] [-s <on|off>] "
+            "[-t <dir>] [-z <ops>]\n");
     fprintf(stderr, "Options\n");
+    fprintf(stderr,
+            "\t-d <on|off> Defer coalescing of freed blocks (default off).\n");
     fprintf(stderr, "\t-f <file>  Use <file> as the trace file.\n");
+    fprintf(stderr,
+            "\t-F <fit>   Placement: first (default), next, best or good.\n");
+    fprintf(stderr,
+            "\t-i <index> Free block index: seglist (default) or tlsf.\n");
+    fprintf(stderr,
+            "\t-o <order> Free list order: lifo (default) or address.\n");
+    fprintf(stderr,
+            "\t-p <on|off> Carve small blocks from the high end of free "
+            "blocks (default off).\n");
+    fprintf(stderr,
+            "\t-P         Compare every placement policy and list order.\n");
+    fprintf(stderr,
+            "\t-s <on|off> Serve requests of up to 128 bytes from slab runs "
+            "(default on).\n");
     fprintf(stderr, "\t-r         Open the malloc REPL.\n");
     fprintf(stderr, "\t-G         Generates a ./gradescope-report.txt file.\n");
     fprintf(stderr, "\t-h         Print this message.\n");
@@ -1086,7 +1551,9 @@ static void usage(void) {
     fprintf(stderr, "\t-t <dir>   Directory to find default traces.\n");
     fprintf(stderr, "\t-v         Print per-trace performance breakdowns.\n");
     fprintf(stderr, "\t-V         Print additional debug info.\n");
-    fprintf(stderr, "\t-p         activates repl\n");
+    fprintf(stderr,
+            "\t-z <ops>   Compare zone resets every <ops> requests with "
+            "per-object frees.\n");
 }
 
 // REPL Code
@@ -1137,7 +1604,8 @@ repl_t *repl_state;
 repl_block_t *find_repl_block_from_block(char *block_ptr, repl_block_t blocks[],
                                          int repl_size) {
     for (int i = 0; i < repl_size; ++i) {
-        if ((blocks[i].ptr - 8) == block_ptr) {
+        if (blocks[i].ptr != NULL &&
+            (char *)payload_to_block(blocks[i].ptr) == block_ptr) {
             return &blocks[i];
         }
     }
@@ -1151,7 +1619,7 @@ repl_block_t *find_repl_block_from_block(char *block_ptr, repl_block_t blocks[],
  */
 void mm_print_heap_repl(repl_block_t blocks[], int repl_size) {
     // prints heap data & prologue
-    block_t *heap_start = (block_t *)mem_heap_lo();
+    block_t *heap_start = (block_t *)((char *)mem_heap_lo() + HEAP_PAD);
     printf("heap size: %d\n", (int)mem_heapsize());
     block_t *b = (block_t *)heap_start;
     printf("prologue \t\tblock at %p \tsize %d\n", (void *)heap_start,
@@ -1184,7 +1652,12 @@ void mm_print_heap_repl(repl_block_t blocks[], int repl_size) {
                    (void *)(block_flink(b)));
         }
         size_t s1 = block_size(b);
+#ifdef MM_FOOTERLESS
+        // allocated blocks have no end tag to compare against
+        size_t s2 = block_allocated(b) ? s1 : block_end_size(b);
+#else
         size_t s2 = block_end_size(b);
+#endif
         if (s1 != s2) {
             printf("block%s at %p had differing size tags: %d and %d\n\n",
                    indexstr, (void *)b, (int)s1, (int)s2);
@@ -1243,7 +1716,7 @@ void print_cmd(const char *msg) {
             return;
         }
 
-        block_t *b = (block_t *)(repl_state->blocks[index].ptr - 8);
+        block_t *b = payload_to_block(repl_state->blocks[index].ptr);
         if (block_allocated(b)) {
             printf("block[%d] allocated \tblock at %p \tsize %d\n", index,
                    (void *)(b), (int)block_size(b));
@@ -1322,8 +1795,8 @@ void malloc_cmd(const char *msg) {
      * to the range list if OK. The block must be  be aligned properly,
      * and must not overlap any currently allocated block.
      */
-    if (add_range(&(repl_state->ranges), p, size, repl_state->tracenum,
-                  repl_state->num_ops) == 0)
+    if (add_range(&(repl_state->ranges), p, size, ALIGNMENT,
+                  repl_state->tracenum, repl_state->num_ops) == 0)
         return;
 
     /* ADDED: cgw
@@ -1399,8 +1872,8 @@ void remalloc_cmd(const char *msg) {
     remove_range(&(repl_state->ranges), oldp);
 
     /* Check new block for correctness and add it to range list */
-    if (add_range(&(repl_state->ranges), newp, size, repl_state->tracenum,
-                  repl_state->num_ops) == 0)
+    if (add_range(&(repl_state->ranges), newp, size, ALIGNMENT,
+                  repl_state->tracenum, repl_state->num_ops) == 0)
         return;
 
     /* ADDED: cgw
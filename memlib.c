@@ -3,8 +3,10 @@
  *            allows us to interleave calls from the student's malloc package
  *            with the system's malloc package in libc.
  */
+#define _GNU_SOURCE /* for mremap */
 #include <assert.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,66 +16,307 @@
 #include "config.h"
 #include "memlib.h"
 
+/*
+ * The model holds MEM_REGIONS disjoint heaps, or regions, each of up to
+ * MAX_HEAP bytes with its own brk. Region r starts r * MAX_HEAP bytes after
+ * region 0, so a region never runs into the next one. Like fresh pages
+ * from the OS, the bytes mem_sbrk adds to a region read as zero: bytes the
+ * region held before it was shrunk or reset are cleared when the brk moves
+ * back over them.
+ */
+
 /* private variables */
-static char *mem_start_brk; /* points to first byte of heap */
-static char *mem_brk;       /* points to last byte of heap */
-static char *mem_max_addr;  /* largest legal heap address */
+static char *mem_start_brk;         /* points to first byte of region 0 */
+static char *mem_brk[MEM_REGIONS];  /* points past the end of each region */
+static char *mem_peak[MEM_REGIONS]; /* highest mem_brk since the last reset */
+static char *mem_dirty[MEM_REGIONS]; /* bytes below may not be zero */
+
+/*
+ * Besides the regions, the model hands out page-aligned mappings of any
+ * size with mmap (mem_map), for allocators that keep huge blocks out of the
+ * heap. Every live mapping is on mem_maps; all of them go away with the
+ * heap at the next mem_reset_brk.
+ */
+typedef struct mem_mapping {
+  char *start;
+  size_t size; /* a multiple of the page size */
+  struct mem_mapping *next;
+} mem_mapping_t;
+
+static mem_mapping_t *mem_maps; /* live mappings */
+static size_t mem_map_bytes;    /* bytes in live mappings */
+static size_t mem_map_peak;     /* highest mem_map_bytes since the reset */
+static pthread_mutex_t mem_map_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /*
  * mem_init - initialize the memory system model
  */
 void mem_init(void) {
   /* allocate the storage we will use to model the available VM */
-  if ((mem_start_brk = (char *)malloc(MAX_HEAP)) == NULL) {
+  if ((mem_start_brk = (char *)calloc(MEM_REGIONS, MAX_HEAP)) == NULL) {
     fprintf(stderr, "mem_init_vm: malloc error\n");
     exit(1);
   }
 
-  mem_max_addr = mem_start_brk + MAX_HEAP; /* max legal heap address */
-  mem_brk = mem_start_brk;                 /* heap is empty initially */
+  for (int r = 0; r < MEM_REGIONS; r++) {
+    mem_dirty[r] = mem_region_lo(r);
+  }
+  mem_reset_brk(); /* heap is empty initially */
 }
 
 /*
  * mem_deinit - free the storage used by the memory system model
  */
-void mem_deinit(void) { free(mem_start_brk); }
+void mem_deinit(void) {
+  mem_reset_brk();
+  free(mem_start_brk);
+}
+
+/*
+ * mem_reset_brk - reset the simulated brk pointers to make every region an
+ *    empty heap, and drop every mapping
+ */
+void mem_reset_brk() {
+  for (int r = 0; r < MEM_REGIONS; r++) {
+    mem_brk[r] = mem_region_lo(r);
+    mem_peak[r] = mem_brk[r];
+  }
+  pthread_mutex_lock(&mem_map_lock);
+  while (mem_maps != NULL) {
+    mem_mapping_t *m = mem_maps;
+    mem_maps = m->next;
+    munmap(m->start, m->size);
+    free(m);
+  }
+  mem_map_bytes = 0;
+  mem_map_peak = 0;
+  pthread_mutex_unlock(&mem_map_lock);
+}
 
 /*
- * mem_reset_brk - reset the simulated brk pointer to make an empty heap
+ * mem_sbrk - simple model of the sbrk function. Extends the heap (region 0)
+ *    by incr bytes and returns the start address of the new area. A
+ *    negative incr shrinks the heap, returning the old brk.
  */
-void mem_reset_brk() { mem_brk = mem_start_brk; }
+void *mem_sbrk(int incr) { return mem_region_sbrk(0, incr); }
 
 /*
- * mem_sbrk - simple model of the sbrk function. Extends the heap
- *    by incr bytes and returns the start address of the new area. In
- *    this model, the heap cannot be shrunk.
+ * mem_region_sbrk - mem_sbrk for region r
  */
-void *mem_sbrk(int incr) {
-  char *old_brk = mem_brk;
+void *mem_region_sbrk(int r, int incr) {
+  char *old_brk = mem_brk[r];
 
-  if ((incr < 0) || ((mem_brk + incr) > mem_max_addr)) {
+  if ((incr < 0) && (mem_brk[r] + incr < (char *)mem_region_lo(r))) {
+    errno = EINVAL;
+    fprintf(stderr, "ERROR: mem_sbrk failed. Cannot shrink below the start\n");
+    return (void *)-1;
+  }
+  if ((mem_brk[r] + incr) > (char *)mem_region_lo(r) + MAX_HEAP) {
     errno = ENOMEM;
     fprintf(stderr, "ERROR: mem_sbrk failed. Ran out of memory...\n");
     return (void *)-1;
   }
-  mem_brk += incr;
+  if (incr > 0 && old_brk < mem_dirty[r]) {
+    char *end = old_brk + incr;
+    memset(old_brk, 0, (end < mem_dirty[r] ? end : mem_dirty[r]) - old_brk);
+  }
+  mem_brk[r] += incr;
+  if (mem_brk[r] > mem_dirty[r]) {
+    mem_dirty[r] = mem_brk[r];
+  }
+  if (mem_brk[r] > mem_peak[r]) {
+    mem_peak[r] = mem_brk[r];
+  }
   return (void *)old_brk;
 }
 
+/*
+ * mem_region_reset - moves region r's brk back to its start, making it an
+ *    empty heap again; its peak is kept
+ */
+void mem_region_reset(int r) { mem_brk[r] = mem_region_lo(r); }
+
+/*
+ * mem_region_lo - return address of the first byte of region r
+ */
+void *mem_region_lo(int r) { return (void *)(mem_start_brk + r * MAX_HEAP); }
+
+/*
+ * mem_region_size - returns the size of region r in bytes
+ */
+size_t mem_region_size(int r) {
+  return (size_t)(mem_brk[r] - (char *)mem_region_lo(r));
+}
+
+/*
+ * mem_region_of - returns the region that address p belongs to
+ */
+int mem_region_of(void *p) {
+  return (int)(((char *)p - mem_start_brk) / MAX_HEAP);
+}
+
 /*
  * mem_heap_lo - return address of the first heap byte
  */
 void *mem_heap_lo() { return (void *)mem_start_brk; }
 
 /*
- * mem_heap_hi - return address of last heap byte
+ * mem_heap_hi - return address of last heap byte, in the highest region
+ *    that is not empty
+ */
+void *mem_heap_hi() {
+  int r = MEM_REGIONS - 1;
+  while (r > 0 && mem_region_size(r) == 0) {
+    r--;
+  }
+  return (void *)(mem_brk[r] - 1);
+}
+
+/*
+ * mem_heapsize() - returns the heap size in bytes, summed over all regions
+ */
+size_t mem_heapsize() {
+  size_t size = 0;
+  for (int r = 0; r < MEM_REGIONS; r++) {
+    size += mem_region_size(r);
+  }
+  return size;
+}
+
+/*
+ * mem_heapsize_peak() - returns the high-water mark of the heap size in
+ *    bytes since the last mem_reset_brk, summed over the regions' own marks
+ */
+size_t mem_heapsize_peak() {
+  size_t size = 0;
+  for (int r = 0; r < MEM_REGIONS; r++) {
+    size += (size_t)(mem_peak[r] - (char *)mem_region_lo(r));
+  }
+  return size;
+}
+
+/*
+ * mem_map_round - rounds size up to a whole number of pages
+ */
+static size_t mem_map_round(size_t size) {
+  size_t page = mem_pagesize();
+  return (size + page - 1) / page * page;
+}
+
+/*
+ * mem_map_find - returns the link that points to the live mapping starting
+ *    at p, or NULL; the caller holds mem_map_lock
+ */
+static mem_mapping_t **mem_map_find(void *p) {
+  for (mem_mapping_t **link = &mem_maps; *link != NULL; link = &(*link)->next) {
+    if ((*link)->start == p) {
+      return link;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * mem_map - maps size bytes, rounded up to whole pages, outside the
+ *    regions and returns their page-aligned start, or (void *)-1
+ */
+void *mem_map(size_t size) {
+  mem_mapping_t *m = malloc(sizeof(mem_mapping_t));
+  if (m == NULL) {
+    return (void *)-1;
+  }
+  m->size = mem_map_round(size);
+  m->start = mmap(NULL, m->size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (m->start == MAP_FAILED) {
+    fprintf(stderr, "ERROR: mem_map failed. Ran out of memory...\n");
+    free(m);
+    return (void *)-1;
+  }
+  pthread_mutex_lock(&mem_map_lock);
+  m->next = mem_maps;
+  mem_maps = m;
+  mem_map_bytes += m->size;
+  if (mem_map_bytes > mem_map_peak) {
+    mem_map_peak = mem_map_bytes;
+  }
+  pthread_mutex_unlock(&mem_map_lock);
+  return m->start;
+}
+
+/*
+ * mem_unmap - unmaps the mapping that mem_map returned as p; returns 0, or
+ *    -1 if p is not a live mapping
+ */
+int mem_unmap(void *p) {
+  pthread_mutex_lock(&mem_map_lock);
+  mem_mapping_t **link = mem_map_find(p);
+  if (link == NULL) {
+    pthread_mutex_unlock(&mem_map_lock);
+    return -1;
+  }
+  mem_mapping_t *m = *link;
+  *link = m->next;
+  mem_map_bytes -= m->size;
+  pthread_mutex_unlock(&mem_map_lock);
+  munmap(m->start, m->size);
+  free(m);
+  return 0;
+}
+
+/*
+ * mem_remap - resizes the mapping that mem_map returned as p to size bytes,
+ *    rounded up to whole pages, in place if the pages after it are free
+ *    and by moving it (without copying) otherwise; returns its new start,
+ *    or (void *)-1 and leaves the mapping as it was
+ */
+void *mem_remap(void *p, size_t size) {
+  pthread_mutex_lock(&mem_map_lock);
+  mem_mapping_t **link = mem_map_find(p);
+  if (link == NULL) {
+    pthread_mutex_unlock(&mem_map_lock);
+    return (void *)-1;
+  }
+  mem_mapping_t *m = *link;
+  size = mem_map_round(size);
+  void *start = mremap(m->start, m->size, size, MREMAP_MAYMOVE);
+  if (start == MAP_FAILED) {
+    pthread_mutex_unlock(&mem_map_lock);
+    return (void *)-1;
+  }
+  mem_map_bytes = mem_map_bytes - m->size + size;
+  if (mem_map_bytes > mem_map_peak) {
+    mem_map_peak = mem_map_bytes;
+  }
+  m->start = start;
+  m->size = size;
+  pthread_mutex_unlock(&mem_map_lock);
+  return start;
+}
+
+/*
+ * mem_mapped - returns 1 if the bytes lo to hi lie in one live mapping
+ */
+int mem_mapped(void *lo, void *hi) {
+  int found = 0;
+  pthread_mutex_lock(&mem_map_lock);
+  for (mem_mapping_t *m = mem_maps; m != NULL && !found; m = m->next) {
+    found = (char *)lo >= m->start && (char *)hi < m->start + m->size;
+  }
+  pthread_mutex_unlock(&mem_map_lock);
+  return found;
+}
+
+/*
+ * mem_mapsize() - returns the number of bytes in live mappings
  */
-void *mem_heap_hi() { return (void *)(mem_brk - 1); }
+size_t mem_mapsize() { return mem_map_bytes; }
 
 /*
- * mem_heapsize() - returns the heap size in bytes
+ * mem_mapsize_peak() - returns the high-water mark of mem_mapsize() since
+ *    the last mem_reset_brk
  */
-size_t mem_heapsize() { return (size_t)(mem_brk - mem_start_brk); }
+size_t mem_mapsize_peak() { return mem_map_peak; }
 
 /*
  * mem_pagesize() - returns the page size of the system
@@ -10,6 +10,26 @@ void mem_reset_brk(void);
 void *mem_heap_lo(void);
 void *mem_heap_hi(void);
 size_t mem_heapsize(void);
+size_t mem_heapsize_peak(void);
 size_t mem_pagesize(void);
 
+/* The simulated memory holds MEM_REGIONS disjoint heaps of up to MAX_HEAP
+   bytes each. mem_sbrk works on region 0; mem_heap_lo, mem_heap_hi and
+   mem_heapsize cover all of them. Memory that mem_sbrk adds reads as zero. */
+#define MEM_REGIONS 8
+void *mem_region_sbrk(int r, int incr);
+void mem_region_reset(int r);
+void *mem_region_lo(int r);
+size_t mem_region_size(int r);
+int mem_region_of(void *p);
+
+/* Page-aligned mappings outside the regions, for huge blocks. Their bytes
+   are counted by mem_mapsize, not mem_heapsize. */
+void *mem_map(size_t size);
+int mem_unmap(void *p);
+void *mem_remap(void *p, size_t size);
+int mem_mapped(void *lo, void *hi);
+size_t mem_mapsize(void);
+size_t mem_mapsize_peak(void);
+
 #endif
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,139 +17,1626 @@
  * Section 3.2 (Support Routines) of the handout has information about
  * the functions in mminline.h and memlib.h
  */
+#include "./config.h"
 #include "./memlib.h"
 #include "./mm.h"
 #include "./mminline.h"
 
 #define EXTENSION (32 * MINBLOCKSIZE)
-static block_t *flist_first;
-block_t *prol;
-block_t *epil;
+// The heap grows by at least a step that starts at EXTENSION and doubles
+// each time it has to grow again within GROW_WINDOW heap allocations, up to
+// GROW_MAX or 1/GROW_SHARE of the heap, whichever is smaller; a step that
+// long without growth goes back to EXTENSION
+#define GROW_MAX (16 * EXTENSION)
+#define GROW_SHARE 16
+#define GROW_WINDOW 64
+// realloc follows the last GROW_TRACK blocks it grew (grower_t). One that
+// has grown GROW_STREAK times in a row and has to move takes 1/GROW_HEADROOM
+// more than asked from a free block, so that its next reallocs are no-ops,
+// or else moves to the end of the heap, where it can grow in place
+#define GROW_TRACK 4
+#define GROW_STREAK 2
+#define GROW_HEADROOM 4
+
+typedef struct grower {
+    void *ptr;    // payload, or NULL if the entry is unused
+    size_t size;  // block size realloc was last asked for
+    int streak;   // reallocs in a row that grew the block
+} grower_t;
+
 #define THRESHOLD (2 * MINBLOCKSIZE)
 
-// rounds up to the nearest multiple of WORD_SIZE
-static inline size_t align(size_t size) {
-    return (((size) + (WORD_SIZE - 1)) & ~(WORD_SIZE - 1));
+// mm_calloc only clears the part of a block below its arena's fresh mark.
+// Every byte from the mark up to the end tag of the free block before the
+// epilogue is zero, as memlib handed it out. Whatever is allocated past the
+// mark moves the mark up past the block, and past the header and the links
+// (up to four words for a tree node) of the free block that may follow it.
+#define FRESH_SKIP (5 * TAG_SIZE)
+
+// With deferred coalescing (mm_set_deferred), freed blocks of up to QUICK_MAX
+// bytes go onto a quick list of their exact size instead of being coalesced.
+// They stay marked allocated, so their neighbours do not merge with them, and
+// a malloc of the same block size takes one back first. The lists are
+// coalesced in one pass (quick_flush) when a search fails or they hold more
+// than QUICK_BUDGET bytes.
+#define QUICK_MAX 1024
+#define QUICK_CLASSES ((int)((QUICK_MAX - MINBLOCKSIZE) / ALIGNMENT) + 1)
+#define QUICK_BUDGET (64 * 1024)
+static int deferred_enabled = 0;  // applied by mm_init
+static int deferred_mode;
+
+// With split placement (mm_set_split), a block of less than SPLIT_SMALL bytes
+// is carved from the high end of the free block it comes from, and larger
+// ones from the low end, so that small blocks gather at the ends of holes
+// instead of between the large ones
+#define SPLIT_SMALL 512
+static int split_enabled = 0;  // applied by mm_init
+static int split_mode;
+static mm_index_t index_mode = MM_INDEX_SEGLIST;  // applied by mm_init
+static mm_fit_t fit_mode = MM_FIT_FIRST;          // applied by mm_init
+static mm_order_t order_mode = MM_ORDER_LIFO;     // applied by mm_init
+
+// A search of a segregated list looks at no more than the arena's probe
+// budget of blocks before it settles for the best seen or moves on. Every
+// PROBE_WINDOW heap allocations, the budget doubles (up to PROBE_MAX) if more
+// than 1/PROBE_SLACK of the heap is in free blocks other than the one at its
+// end, so that a fragmented heap is searched harder, and halves (down to
+// PROBE_MIN) otherwise
+#define PROBE_MIN 4
+#define PROBE_MAX 256
+#define PROBE_WINDOW 256
+#define PROBE_SLACK 8
+
+// A free block at the end of a heap that grows past trim_threshold bytes is
+// cut back to EXTENSION bytes, and the rest is given back to memlib
+#define TRIM_THRESHOLD (128 * 1024)
+static size_t trim_set = TRIM_THRESHOLD;  // applied by mm_init
+static size_t trim_threshold;
+
+// Requests of at least mmap_threshold bytes bypass the heap: each gets its
+// own memlib mapping (mem_map), which mm_free unmaps and mm_realloc resizes
+// with mem_remap. The mapping's length is kept in the word before the
+// payload.
+#define MMAP_THRESHOLD (128 * 1024)
+#define HUGE_HEADER ALIGNMENT
+static size_t mmap_set = MMAP_THRESHOLD;  // applied by mm_init
+static size_t mmap_threshold;
+// the heap is divided into pages of PAGE_SIZE bytes, counted from
+// mem_heap_lo(); see the page map below
+#define PAGE_SIZE 4096
+#define HEAP_PAGES ((size_t)MEM_REGIONS * MAX_HEAP / PAGE_SIZE)
+
+/*
+ * Small requests (up to SLAB_MAX_SIZE bytes) are served from runs: allocated
+ * blocks of RUN_SIZE bytes whose payload is cut into equal slots of a single
+ * size class, with no tags per slot. A run's header, run_t, sits at the start
+ * of its payload and keeps a bitmap of free slots. Run blocks are placed so
+ * they cover exactly one page of the heap.
+ */
+#define RUN_SIZE PAGE_SIZE
+#define SLAB_MAX_SIZE 128
+#define SLAB_CLASSES (SLAB_MAX_SIZE / ALIGNMENT)
+#define RUN_MAX_SLOTS (RUN_SIZE / ALIGNMENT)
+
+typedef struct run {
+    struct run *next;  // runs of the same class that have a free slot
+    struct run *prev;
+    size_t slot_size;
+    unsigned nslots;
+    unsigned nfree;
+    uint64_t free_map[RUN_MAX_SLOTS / 64];  // bit i is set iff slot i is free
+} run_t;
+
+/*
+ * The page map describes every page of the memlib heap so that mm_free and
+ * mm_realloc can find what a pointer belongs to from its address alone. A
+ * page either holds ordinary boundary-tag blocks, whose headers must be read,
+ * or belongs to a span such as a run, whose descriptor is kept here. The
+ * heap-growth path fills the map in and releasing a span clears it.
+ */
+typedef enum { SPAN_BLOCKS, SPAN_RUN } span_kind_t;
+
+typedef struct span {
+    span_kind_t kind;
+    unsigned slot_size;  // SPAN_RUN: size of the run's slots
+    run_t *run;          // SPAN_RUN: header of the run covering the page
+} span_t;
+
+static span_t page_map[HEAP_PAGES];
+static int slab_enabled = 1;  // applied by mm_init
+static int slab_mode;
+
+/*
+ * The heap is split into arenas: separate boundary-tag heaps, each in its
+ * own memlib region (arena i in region i) with its own free block index,
+ * runs and lock, so that threads on different arenas do not contend. A
+ * thread is assigned the arena with the fewest threads when it first
+ * allocates, and allocates only from that arena. A block is always freed
+ * into the arena whose region holds it, whichever thread frees it. Arena 0
+ * is set up by mm_init, the others when their first thread is assigned.
+ *
+ * A thread that frees an object of another arena does not take that arena's
+ * lock: it pushes the object onto the arena's remote-free stack with a CAS.
+ * Whoever next locks the arena (arena_lock) takes the whole stack with one
+ * atomic exchange and frees it in a batch. Pushes from many threads and a
+ * single consumer at a time, under the lock, make it ABA-free.
+ *
+ * An arena whose region has not been used since mm_init can instead become
+ * a heap handle (mm_heap_t, see mm_heap_create). Threads are never assigned
+ * to it, and its blocks bypass the thread caches and central stacks, so
+ * that mm_heap_destroy can drop the whole region at once.
+ */
+typedef struct arena {
+    pthread_mutex_t lock;  // guards everything below but nthreads
+    unsigned nthreads;     // threads assigned to the arena, see assign_lock
+    int region;            // memlib region holding the arena's heap
+    int ready;             // the heap has been set up since the last mm_init
+    int heap;              // owned by an mm_heap_t handle, see assign_lock
+    block_t *prol;
+    block_t *epil;
+    flist_t flist;
+    run_t *slab_partial[SLAB_CLASSES];  // lists of runs with free slots
+    size_t pages_used;  // page map entries of the region from here on are clear
+    size_t grow;        // current growth step, see grow_size
+    unsigned long mallocs;  // heap_malloc calls, the clock for grow_size
+    unsigned long grow_at;  // mallocs at the last growth
+    size_t realloc_copied;  // see mm_counters_t
+    size_t realloc_saved;
+    grower_t growers[GROW_TRACK];  // blocks realloc has been growing
+    unsigned grow_next;            // entry of growers to reuse next
+    block_t *quick[QUICK_CLASSES];  // deferred frees, linked by payload[0]
+    size_t quick_bytes;             // bytes on the quick lists
+    char *fresh;   // the heap is zero from here on, see FRESH_SKIP
+    void *remote;  // objects freed by other threads, linked by first word
+} arena_t;
+
+static arena_t arenas[MEM_REGIONS];
+static pthread_mutex_t assign_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t arenas_once = PTHREAD_ONCE_INIT;
+static int narenas_set = MEM_REGIONS;  // applied by mm_init
+static int narenas;
+static int remote_enabled = 1;  // applied by mm_init
+static int remote_mode;
+
+/*
+ * Between the thread caches and the arenas sits a central layer: one
+ * lock-free LIFO stack of free slab slots per slot size, shared by all
+ * threads. A cache drains into it and refills from it before falling back
+ * to its arena's lock, and without caches mm_malloc and mm_free use it
+ * directly. The top of a stack is a single word holding the object's offset
+ * from mem_heap_lo() in its low 32 bits (enough for MEM_REGIONS * MAX_HEAP)
+ * and a generation in its high 32 bits, bumped by every push and pop, so a
+ * pop whose top was popped and pushed back in the meantime fails its CAS
+ * instead of installing a stale next pointer (the ABA problem). Objects on
+ * a stack stay allocated as far as their run is concerned; each stack holds
+ * about CENTRAL_LIMIT of them at most.
+ */
+#define CENTRAL_LIMIT 64
+#define CENTRAL_GEN ((uint64_t)1 << 32)
+#define CENTRAL_OFFSET (CENTRAL_GEN - 1)
+
+static uint64_t central[SLAB_CLASSES];        // tagged tops of the stacks
+static unsigned central_count[SLAB_CLASSES];  // approximate stack depths
+static int central_enabled = 1;               // applied by mm_init
+static int central_mode;
+
+/*
+ * mm_malloc, mm_free and mm_realloc may be called from several threads.
+ * Besides its arena, each thread caches freed slab slots (objects of up to
+ * TCACHE_MAX_SIZE bytes), in one list per slot size, so that most small
+ * requests finish without taking a lock. An empty list is refilled, and a
+ * full one drained, TCACHE_BATCH objects at a time under a single lock
+ * acquisition. mm_init starts a new heap_epoch; thread state from an older
+ * heap is dropped.
+ */
+#define TCACHE_MAX_SIZE SLAB_MAX_SIZE
+#define TCACHE_CLASSES (TCACHE_MAX_SIZE / ALIGNMENT)
+#define TCACHE_BATCH 16
+#define TCACHE_LIMIT (2 * TCACHE_BATCH)
+
+typedef struct tcache {
+    unsigned epoch;  // heap_epoch of the heap the objects came from
+    arena_t *arena;  // the arena the thread allocates from
+    unsigned count[TCACHE_CLASSES];
+    void *head[TCACHE_CLASSES];  // objects are linked through their first word
+} tcache_t;
+
+static __thread tcache_t tcache;
+static pthread_key_t tcache_key;  // drains a thread's cache when it exits
+static pthread_once_t tcache_key_once = PTHREAD_ONCE_INIT;
+static unsigned heap_epoch;
+static int tcache_enabled = 1;  // applied by mm_init
+static int tcache_mode;
+
+// rounds up to the nearest multiple of WORD_SIZE
+static inline size_t align(size_t size) {
+    return (((size) + (WORD_SIZE - 1)) & ~(WORD_SIZE - 1));
+}
+
+/*
+arenas_create: sets up the arenas' locks, once per process.
+*/
+static void arenas_create(void) {
+    for (int i = 0; i < MEM_REGIONS; i++) {
+        pthread_mutex_init(&arenas[i].lock, NULL);
+        arenas[i].region = i;
+    }
+}
+
+/*
+arena_init: starts an empty heap, a prologue and an epilogue, in the arena's
+memlib region. The caller holds a's lock, or is mm_init.
+returns 0, or -1 if the region cannot grow.
+*/
+static int arena_init(arena_t *a) {
+    char *start = mem_region_sbrk(a->region, HEAP_PAD + 2 * TAGS_SIZE);
+    if (start == (void *)-1) {
+        return -1;
+    }
+    size_t first_page =
+        (size_t)((char *)mem_region_lo(a->region) - (char *)mem_heap_lo()) /
+        PAGE_SIZE;
+    if (a->pages_used > first_page) {
+        memset(&page_map[first_page], 0,
+               (a->pages_used - first_page) * sizeof(span_t));
+    }
+    a->pages_used = first_page;
+    a->prol = (block_t *)(start + HEAP_PAD);
+    flist_reset(&a->flist, index_mode, fit_mode, order_mode);
+    a->flist.probe_budget = PROBE_MAX;
+    memset(a->slab_partial, 0, sizeof(a->slab_partial));
+    block_set_size_and_allocated(a->prol, TAGS_SIZE, 1);
+    a->epil = block_next(a->prol);
+    block_set_size_and_allocated(a->epil, TAGS_SIZE, 1);
+    block_set_prev_allocated(a->prol, 1);
+    block_set_prev_allocated(a->epil, 1);
+    a->remote = NULL;
+    a->grow = EXTENSION;
+    a->mallocs = 0;
+    a->grow_at = 0;
+    a->realloc_copied = 0;
+    a->realloc_saved = 0;
+    memset(a->growers, 0, sizeof(a->growers));
+    a->grow_next = 0;
+    memset(a->quick, 0, sizeof(a->quick));
+    a->quick_bytes = 0;
+    a->fresh = (char *)a->epil;
+    a->ready = 1;
+    return 0;
+}
+
+/*
+ *                             _       _ _
+ *     _ __ ___  _ __ ___     (_)_ __ (_) |_
+ *    | '_ ` _ \| '_ ` _ \    | | '_ \| | __|
+ *    | | | | | | | | | | |   | | | | | | |_
+ *    |_| |_| |_|_| |_| |_|___|_|_| |_|_|\__|
+ *                       |_____|
+ *
+ * initializes the dynamic storage allocator (allocate initial heap space)
+ * arguments: none
+ * returns: 0, if successful
+ *         -1, if an error occurs
+ */
+int mm_init(void) {
+    pthread_once(&arenas_once, arenas_create);
+    for (int i = 0; i < MEM_REGIONS; i++) {
+        arenas[i].ready = 0;
+        arenas[i].nthreads = 0;
+        arenas[i].heap = 0;
+        arenas[i].remote = NULL;
+    }
+    memset(central, 0, sizeof(central));
+    memset(central_count, 0, sizeof(central_count));
+    narenas = narenas_set;
+    remote_mode = remote_enabled;
+    slab_mode = slab_enabled;
+    tcache_mode = tcache_enabled && slab_enabled;
+    central_mode = central_enabled && slab_enabled;
+    trim_threshold = trim_set;
+    mmap_threshold = mmap_set;
+    deferred_mode = deferred_enabled;
+    split_mode = split_enabled;
+    heap_epoch++;
+    return arena_init(&arenas[0]);
+}
+
+/*
+selects the free block index used by mm_malloc. Takes effect at the next
+call to mm_init.
+*/
+void mm_set_index(mm_index_t index) { index_mode = index; }
+
+/*
+selects how mm_malloc searches a segregated list. Takes effect at the next
+call to mm_init.
+*/
+void mm_set_fit(mm_fit_t fit) { fit_mode = fit; }
+
+/*
+selects where freed blocks go in their segregated list. Takes effect at the
+next call to mm_init.
+*/
+void mm_set_order(mm_order_t order) { order_mode = order; }
+
+/*
+turns the slab allocator for small requests on (the default) or off. Takes
+effect at the next call to mm_init.
+*/
+void mm_set_slab(int enabled) { slab_enabled = enabled; }
+
+/*
+turns the per-thread caches of small freed objects on (the default) or off.
+The caches hold slab slots, so they are off while the slab allocator is.
+Takes effect at the next call to mm_init.
+*/
+void mm_set_tcache(int enabled) { tcache_enabled = enabled; }
+
+/*
+sets the number of arenas that threads are spread over, from 1 to
+MEM_REGIONS (the default). Takes effect at the next call to mm_init.
+*/
+void mm_set_arenas(int n) {
+    narenas_set = (n < 1) ? 1 : (n > MEM_REGIONS) ? MEM_REGIONS : n;
+}
+
+/*
+turns the remote-free stacks on (the default) or off; when off, a thread
+freeing another arena's object takes that arena's lock. Takes effect at the
+next call to mm_init.
+*/
+void mm_set_remote_free(int enabled) { remote_enabled = enabled; }
+
+/*
+turns the central lock-free stacks of small freed objects on (the default)
+or off. They hold slab slots, so they are off while the slab allocator is.
+Takes effect at the next call to mm_init.
+*/
+void mm_set_central(int enabled) { central_enabled = enabled; }
+
+/*
+sets how large the free block at the end of the heap may grow before the
+heap is trimmed, in bytes; 0 turns trimming off. Takes effect at the next
+call to mm_init.
+*/
+void mm_set_trim(size_t threshold) { trim_set = threshold; }
+
+/*
+sets the size from which requests get their own mapping instead of a heap
+block, in bytes; 0 keeps every request in the heap. Takes effect at the next
+call to mm_init.
+*/
+void mm_set_mmap_threshold(size_t threshold) { mmap_set = threshold; }
+
+/*
+turns deferred coalescing on or off (the default). Takes effect at the next
+call to mm_init.
+*/
+void mm_set_deferred(int enabled) { deferred_enabled = enabled; }
+
+/*
+turns split placement on or off (the default). Takes effect at the next call
+to mm_init.
+*/
+void mm_set_split(int enabled) { split_enabled = enabled; }
+
+/*
+mm_get_counters: fills c with the counters of every arena set up since the
+last call to mm_init.
+*/
+void mm_get_counters(mm_counters_t *c) {
+    memset(c, 0, sizeof(*c));
+    for (int i = 0; i < MEM_REGIONS; i++) {
+        arena_t *a = &arenas[i];
+        pthread_mutex_lock(&a->lock);
+        if (a->ready) {
+            c->realloc_copied += a->realloc_copied;
+            c->realloc_saved += a->realloc_saved;
+            if (a->flist.search_max > c->search_max) {
+                c->search_max = a->flist.search_max;
+            }
+        }
+        pthread_mutex_unlock(&a->lock);
+    }
+}
+
+// moves arena a's fresh mark past block b, which has just been allocated,
+// and the header and links of the free block that may follow it
+static inline void fresh_note(arena_t *a, block_t *b) {
+    char *end = (char *)block_next(b) + FRESH_SKIP;
+    if (end > a->fresh) {
+        a->fresh = end;
+    }
+}
+
+/*
+coalesce function, takes in a free block and checks neighbors if their free.
+If so, merges by manipulating block sizes and puts the new block into the list.
+*/
+static inline void coalesce(arena_t *a, block_t *fb) {
+    size_t s = block_size(fb);
+
+    block_t *b = fb;
+    if (block_prev_allocated(b) == 0) {
+        b = block_prev(b);
+        s += block_size(b);
+        pull_free_block(&a->flist, b);
+    }
+
+    block_t *f = fb;
+    if (block_next_allocated(f) == 0) {
+        f = block_next(f);
+        s += block_size(f);
+        pull_free_block(&a->flist, f);
+    }
+
+    block_set_size_and_allocated(b, s, 0);
+    block_set_prev_allocated(block_next(b), 0);
+    insert_free_block(&a->flist, b);
+}
+
+/*
+grow_size: picks how far to grow arena a's heap when it is need bytes short,
+and adapts the growth step to how often the heap has been growing.
+returns the number of bytes to sbrk, at least need.
+*/
+static inline size_t grow_size(arena_t *a, size_t need) {
+    if (a->mallocs - a->grow_at < GROW_WINDOW) {
+        size_t cap = mem_region_size(a->region) / GROW_SHARE;
+        if (a->grow < GROW_MAX && a->grow * 2 <= cap) {
+            a->grow *= 2;
+        }
+    } else {
+        a->grow = EXTENSION;
+    }
+    a->grow_at = a->mallocs;
+    return (need > a->grow) ? need : a->grow;
+}
+
+/*
+probe_adapt: sets arena a's probe budget from how much of its heap lies in
+free blocks before its end.
+*/
+static void probe_adapt(arena_t *a) {
+    size_t holes = a->flist.free_bytes;
+    if (!block_prev_allocated(a->epil)) {
+        holes -= block_size(block_prev(a->epil));
+    }
+    int budget = a->flist.probe_budget;
+    if (holes * PROBE_SLACK > mem_region_size(a->region)) {
+        budget = (budget * 2 < PROBE_MAX) ? budget * 2 : PROBE_MAX;
+    } else {
+        budget = (budget / 2 > PROBE_MIN) ? budget / 2 : PROBE_MIN;
+    }
+    a->flist.probe_budget = budget;
+}
+
+/*
+function for extending the heap so that a block of size bytes fits at its
+end. A free block before the epilogue already covers part of it, so only
+the shortfall is requested, or the current growth step if that is larger.
+*/
+static inline block_t *extend_heap(arena_t *a, size_t size) {
+    size_t need = size;
+    if (!block_prev_allocated(a->epil)) {
+        size_t tail = block_size(block_prev(a->epil));
+        need = (tail < size) ? size - tail : 0;
+    }
+    size_t s = grow_size(a, need);
+    void *err = mem_region_sbrk(a->region, s);
+    if (err == (void *)-1) {
+        return NULL;
+    }
+    tag_t *old = (tag_t *)a->epil;
+    int merge = !block_prev_allocated(a->epil);
+    block_set_size_and_allocated(a->epil, s, 0);
+    a->epil = block_next(a->epil);
+    block_set_size_and_allocated(a->epil, TAGS_SIZE, 1);
+    coalesce(a, block_prev(a->epil));
+    if (!merge) {
+        // the new free block starts at the old epilogue
+        if ((char *)old + FRESH_SKIP > a->fresh) {
+            a->fresh = (char *)old + FRESH_SKIP;
+        }
+    } else if ((char *)(old - 1) >= a->fresh) {
+        // the old end tag and epilogue are now inside the last free block
+        memset(old - 1, 0, TAG_SIZE + TAGS_SIZE);
+    } else if ((char *)old + TAGS_SIZE > a->fresh) {
+        a->fresh = (char *)old + TAGS_SIZE;
+    }
+    return a->epil;
+}
+
+/*
+trim_heap: if the free block at the end of arena a's heap is larger than
+trim_threshold, shrinks it to EXTENSION bytes and moves the break back over
+the rest.
+*/
+static inline void trim_heap(arena_t *a) {
+    if (trim_threshold == 0 || block_prev_allocated(a->epil)) {
+        return;
+    }
+    block_t *last = block_prev(a->epil);
+    size_t s = block_size(last);
+    if (s <= trim_threshold || s <= EXTENSION) {
+        return;
+    }
+    size_t release = s - EXTENSION;
+    if (mem_region_sbrk(a->region, -(int)release) == (void *)-1) {
+        return;
+    }
+    pull_free_block(&a->flist, last);
+    block_set_size_and_allocated(last, EXTENSION, 0);
+    insert_free_block(&a->flist, last);
+    a->epil = block_next(last);
+    block_set_size_and_allocated(a->epil, TAGS_SIZE, 1);
+    block_set_prev_allocated(a->epil, 0);
+    char *tag = (char *)a->epil - TAG_SIZE;
+    if (a->fresh > tag) {
+        a->fresh = tag;
+    }
+}
+
+/*
+function for checking if the block size is big enough for the
+requested block size.
+returns -1 if block is too small, 0 if all of block must be allocated
+and 1 if only a portion of the block must be allocated.
+*/
+static inline int isbig(size_t bs, size_t size) {
+    if (bs >= size) {
+        if (bs >= (size + THRESHOLD)) {
+            return 1;
+        }
+        return 0;
+    }
+    return -1;
+}
+
+/*
+place: allocates a block of 'size' bytes out of the free block fb. If the
+leftover space is large enough it is split off into a new free block.
+returns the allocated block: fb, or with split placement and a small block,
+the end of fb.
+*/
+static inline block_t *place(arena_t *a, block_t *fb, size_t size) {
+    pull_free_block(&a->flist, fb);
+    if (isbig(block_size(fb), size) == 1) {
+        //  ^^ free block has leftover space > MINBLOCKSPACE
+        size_t leftover = block_size(fb) - size;
+        if (split_mode && size < SPLIT_SMALL) {
+            block_set_size(fb, leftover);
+            insert_free_block(&a->flist, fb);
+            block_t *ab = block_next(fb);
+            block_set_size_and_allocated(ab, size, 1);
+            block_set_prev_allocated(ab, 0);
+            block_set_prev_allocated(block_next(ab), 1);
+            fresh_note(a, ab);
+            return ab;
+        }
+        block_set_size_and_allocated(fb, size, 1);
+        block_t *adjacent = block_next(fb);
+        block_set_size_and_allocated(adjacent, leftover, 0);
+        block_set_prev_allocated(adjacent, 1);
+        insert_free_block(&a->flist, adjacent);
+    } else {
+        //  ^^ free block does not have leftover space > MINBLOCKSPACE
+        block_set_allocated(fb, 1);
+        block_set_prev_allocated(block_next(fb), 1);
+    }
+    fresh_note(a, fb);
+    return fb;
+}
+
+/*
+search: a function for looking through the free block index to identify a
+free block, and allocating 'size' bytes out of it.
+returns pointer to the allocated block, NULL if no free block is big enough.
+*/
+static inline block_t *search(arena_t *a, size_t size) {
+    block_t *fb = flist_find(&a->flist, size);
+    if (fb == NULL) {
+        return NULL;
+    }
+    return place(a, fb, size);
+}
+
+// returns where the first run block at or after start can go: on the first
+// page that leaves either no gap or a whole free block between start and it
+static inline char *run_start(char *start) {
+    char *lo = mem_heap_lo();
+    size_t page = ((size_t)(start - lo) - HEAP_PAD + RUN_SIZE - 1) / RUN_SIZE;
+    char *run = lo + page * RUN_SIZE + HEAP_PAD;
+    if (run != start && (size_t)(run - start) < MINBLOCKSIZE) {
+        run += RUN_SIZE;
+    }
+    return run;
+}
+
+/*
+run_block_reuse: carves a RUN_SIZE block covering one page out of the free
+block fb, typically the space of a run that emptied. Any space skipped
+before the run, or left after it, stays a free block.
+returns the allocated run block, NULL if no page fits in fb.
+*/
+static inline block_t *run_block_reuse(arena_t *a, block_t *fb) {
+    char *start = (char *)fb;
+    char *limit = start + block_size(fb);
+    char *run = run_start(start);
+    char *end = run + RUN_SIZE;
+    if (end > limit || (end != limit && (size_t)(limit - end) < MINBLOCKSIZE)) {
+        return NULL;
+    }
+
+    pull_free_block(&a->flist, fb);
+    if (run != start) {
+        block_set_size_and_allocated(fb, run - start, 0);
+        insert_free_block(&a->flist, fb);
+    }
+    block_t *rb = (block_t *)run;
+    block_set_size_and_allocated(rb, RUN_SIZE, 1);
+    block_set_prev_allocated(rb, run == start);
+    if (end != limit) {
+        block_t *rest = (block_t *)end;
+        block_set_size_and_allocated(rest, limit - end, 0);
+        block_set_prev_allocated(rest, 1);
+        insert_free_block(&a->flist, rest);
+    } else {
+        block_set_prev_allocated((block_t *)end, 1);
+    }
+    return rb;
+}
+
+/*
+run_block_alloc: carves a RUN_SIZE block out of the end of the heap, placed
+so that it covers one page. A free block at the end of the heap is
+reused and the heap is only extended by what is missing. Any space skipped
+before the run, or left after it, becomes a free block.
+returns the allocated run block, NULL if the heap cannot grow.
+*/
+static inline block_t *run_block_alloc(arena_t *a) {
+    char *start = (char *)a->epil;
+    if (!block_prev_allocated(a->epil)) {
+        start = (char *)block_prev(a->epil);
+    }
+
+    char *run = run_start(start);
+    char *end = run + RUN_SIZE;
+    char *new_epil = (char *)a->epil;
+    if (new_epil < end) {
+        new_epil = (char *)a->epil + grow_size(a, end - (char *)a->epil);
+    }
+    if (new_epil != end && (size_t)(new_epil - end) < MINBLOCKSIZE) {
+        new_epil = end + MINBLOCKSIZE;
+    }
+    if (new_epil != (char *)a->epil &&
+        mem_region_sbrk(a->region, new_epil - (char *)a->epil) == (void *)-1) {
+        return NULL;
+    }
+
+    if (start != (char *)a->epil) {
+        pull_free_block(&a->flist, (block_t *)start);
+    }
+    if (run != start) {
+        block_set_size_and_allocated((block_t *)start, run - start, 0);
+        insert_free_block(&a->flist, (block_t *)start);
+    }
+    block_t *rb = (block_t *)run;
+    block_set_size_and_allocated(rb, RUN_SIZE, 1);
+    block_set_prev_allocated(rb, run == start);
+    if (new_epil != end) {
+        block_t *rest = (block_t *)end;
+        block_set_size_and_allocated(rest, new_epil - end, 0);
+        block_set_prev_allocated(rest, 1);
+        insert_free_block(&a->flist, rest);
+    }
+    a->epil = (block_t *)new_epil;
+    block_set_size_and_allocated(a->epil, TAGS_SIZE, 1);
+    block_set_prev_allocated(a->epil, new_epil == end);
+    return rb;
+}
+
+// returns the page map entry of the page holding ptr
+static inline span_t *page_span(void *ptr) {
+    return &page_map[(size_t)((char *)ptr - (char *)mem_heap_lo()) / PAGE_SIZE];
+}
+
+// returns the address of the run's first slot
+static inline char *run_slots(run_t *r) {
+    return (char *)r + align(sizeof(run_t));
+}
+
+// links r at the head of its class's list of runs with free slots
+static inline void run_link(arena_t *a, run_t *r) {
+    run_t **head = &a->slab_partial[r->slot_size / ALIGNMENT - 1];
+    r->prev = NULL;
+    r->next = *head;
+    if (*head != NULL) {
+        (*head)->prev = r;
+    }
+    *head = r;
+}
+
+// unlinks r from its class's list of runs with free slots
+static inline void run_unlink(arena_t *a, run_t *r) {
+    if (r->prev != NULL) {
+        r->prev->next = r->next;
+    } else {
+        a->slab_partial[r->slot_size / ALIGNMENT - 1] = r->next;
+    }
+    if (r->next != NULL) {
+        r->next->prev = r->prev;
+    }
+}
+
+/*
+run_new: makes a run of slot_size slots, all free, and links it into the
+partial list of its class.
+returns the run, NULL if the heap cannot grow.
+*/
+static inline run_t *run_new(arena_t *a, size_t slot_size) {
+    block_t *rb = NULL;
+    block_t *fb = flist_find(&a->flist, RUN_SIZE);
+    if (fb != NULL) {
+        rb = run_block_reuse(a, fb);
+    }
+    if (rb == NULL) {
+        rb = run_block_alloc(a);
+    }
+    if (rb == NULL) {
+        return NULL;
+    }
+    fresh_note(a, rb);
+    run_t *r = (run_t *)rb->payload;
+    r->slot_size = slot_size;
+    r->nslots = (RUN_SIZE - ALLOC_TAGS_SIZE - align(sizeof(run_t))) / slot_size;
+    r->nfree = r->nslots;
+    memset(r->free_map, 0, sizeof(r->free_map));
+    for (unsigned i = 0; i < r->nslots / 64; i++) {
+        r->free_map[i] = ~(uint64_t)0;
+    }
+    if (r->nslots % 64) {
+        r->free_map[r->nslots / 64] = ((uint64_t)1 << (r->nslots % 64)) - 1;
+    }
+    run_link(a, r);
+    span_t *span = page_span(r);
+    span->kind = SPAN_RUN;
+    span->slot_size = slot_size;
+    span->run = r;
+    if (a->pages_used <= (size_t)(span - page_map)) {
+        a->pages_used = span - page_map + 1;
+    }
+    return r;
+}
+
+/*
+slab_malloc: takes the lowest free slot of the first run with room in the
+size class of 'size' bytes, making a new run if there is none.
+returns the slot, NULL if the heap cannot grow.
+*/
+static inline void *slab_malloc(arena_t *a, size_t size) {
+    size_t slot_size = align(size);
+    run_t *r = a->slab_partial[slot_size / ALIGNMENT - 1];
+    if (r == NULL && (r = run_new(a, slot_size)) == NULL) {
+        return NULL;
+    }
+    unsigned w = 0;
+    while (r->free_map[w] == 0) {
+        w++;
+    }
+    unsigned bit = __builtin_ctzll(r->free_map[w]);
+    r->free_map[w] &= ~((uint64_t)1 << bit);
+    if (--r->nfree == 0) {
+        run_unlink(a, r);
+    }
+    return run_slots(r) + (w * 64 + bit) * slot_size;
+}
+
+/*
+slab_free: returns a slot to its run. A run that becomes empty goes back to
+the heap as a free block, unless it is the only run of its class with room.
+*/
+static inline void slab_free(arena_t *a, run_t *r, void *ptr) {
+    size_t i = (size_t)((char *)ptr - run_slots(r)) / r->slot_size;
+    r->free_map[i / 64] |= (uint64_t)1 << (i % 64);
+    if (r->nfree++ == 0) {
+        run_link(a, r);
+    }
+    if (r->nfree == r->nslots && (r->prev != NULL || r->next != NULL)) {
+        run_unlink(a, r);
+        page_span(r)->kind = SPAN_BLOCKS;
+        block_t *rb = payload_to_block(r);
+        block_set_allocated(rb, 0);
+        coalesce(a, rb);
+    }
+}
+
+// returns the growers entry of the block at ptr, or NULL
+static inline grower_t *grower_find(arena_t *a, void *ptr) {
+    for (int i = 0; i < GROW_TRACK; i++) {
+        if (a->growers[i].ptr == ptr) {
+            return &a->growers[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+grower_note: records that realloc was asked to make the block at ptr size
+bytes, taking over the oldest entry if the block is not followed yet.
+returns its entry.
+*/
+static grower_t *grower_note(arena_t *a, void *ptr, size_t size) {
+    grower_t *g = grower_find(a, ptr);
+    if (g == NULL) {
+        g = &a->growers[a->grow_next++ % GROW_TRACK];
+        g->ptr = ptr;
+        g->streak = 0;
+    } else if (size <= g->size) {
+        g->streak = 0;
+    }
+    g->streak++;
+    g->size = size;
+    return g;
+}
+
+/*
+grower_reclaim: gives back the headroom of every block being followed, by
+cutting it to the size realloc was last asked for.
+returns 1 if any memory was freed.
+*/
+static int grower_reclaim(arena_t *a) {
+    int freed = 0;
+    for (int i = 0; i < GROW_TRACK; i++) {
+        grower_t *g = &a->growers[i];
+        if (g->ptr == NULL) {
+            continue;
+        }
+        block_t *b = payload_to_block(g->ptr);
+        if (block_size(b) >= g->size + MINBLOCKSIZE) {
+            size_t rest = block_size(b) - g->size;
+            block_set_size(b, g->size);
+            block_t *next = block_next(b);
+            block_set_size_and_allocated(next, rest, 0);
+            block_set_prev_allocated(next, 1);
+            coalesce(a, next);
+            freed = 1;
+        }
+    }
+    return freed;
+}
+
+/*
+quick_flush: frees every block on arena a's quick lists, coalescing each
+with its neighbours.
+returns 1 if there were any.
+*/
+static int quick_flush(arena_t *a) {
+    if (a->quick_bytes == 0) {
+        return 0;
+    }
+    for (int c = 0; c < QUICK_CLASSES; c++) {
+        block_t *b = a->quick[c];
+        while (b != NULL) {
+            block_t *next = link_to_block(b->payload[0]);
+            block_set_allocated(b, 0);
+            coalesce(a, b);
+            b = next;
+        }
+        a->quick[c] = NULL;
+    }
+    a->quick_bytes = 0;
+    return 1;
+}
+
+// puts allocated block b on its quick list, flushing the lists if they
+// have outgrown QUICK_BUDGET
+static inline void quick_push(arena_t *a, block_t *b) {
+    int c = (block_size(b) - MINBLOCKSIZE) / ALIGNMENT;
+    b->payload[0] = block_to_link(a->quick[c]);
+    a->quick[c] = b;
+    a->quick_bytes += block_size(b);
+    if (a->quick_bytes > QUICK_BUDGET) {
+        quick_flush(a);
+    }
+}
+
+// takes a block of exactly size bytes off its quick list, or returns NULL
+static inline block_t *quick_pop(arena_t *a, size_t size) {
+    int c = (size - MINBLOCKSIZE) / ALIGNMENT;
+    block_t *b = a->quick[c];
+    if (b != NULL) {
+        a->quick[c] = link_to_block(b->payload[0]);
+        a->quick_bytes -= size;
+    }
+    return b;
+}
+
+/*
+heap_malloc: mm_malloc from arena a without the thread cache; the caller
+holds a's lock.
+*/
+static void *heap_malloc(arena_t *a, size_t size) {
+    block_t *err;
+    size_t s = align(size + ALLOC_TAGS_SIZE);
+    // no region holds more than MAX_HEAP bytes, and a larger size could
+    // wrap s around to a small block
+    if (size == 0 || size > MAX_HEAP) {
+        return NULL;
+    } else {
+        if (++a->mallocs % PROBE_WINDOW == 0) {
+            probe_adapt(a);
+        }
+        if (slab_mode && size <= SLAB_MAX_SIZE) {
+            void *slot = slab_malloc(a, size);
+            if (slot != NULL) {
+                return slot;
+            }
+        }
+        if (s < MINBLOCKSIZE) {
+            s = MINBLOCKSIZE;
+        }
+
+        if (deferred_mode && s <= QUICK_MAX) {
+            block_t *qb = quick_pop(a, s);
+            if (qb != NULL) {
+                return qb->payload;
+            }
+        }
+        block_t *fb = search(a, s);
+        if (fb == NULL && quick_flush(a)) {
+            fb = search(a, s);
+        }
+        if (fb == NULL && grower_reclaim(a)) {
+            fb = search(a, s);
+        }
+        while (fb == NULL) {
+            err = extend_heap(a, s);
+            if (err == NULL) {
+                return NULL;
+            }
+            fb = search(a, s);
+        }
+        return (fb->payload);
+    }
+    return NULL;
+}
+
+/*
+heap_free: mm_free into arena a, which owns ptr, without the thread cache;
+the caller holds a's lock.
+*/
+static void heap_free(arena_t *a, void *ptr) {
+    span_t *span = page_span(ptr);
+    if (span->kind == SPAN_RUN) {
+        slab_free(a, span->run, ptr);
+    } else {
+        grower_t *g = grower_find(a, ptr);
+        if (g != NULL) {
+            g->ptr = NULL;
+        }
+        block_t *b = payload_to_block(ptr);
+        if (deferred_mode && block_size(b) <= QUICK_MAX) {
+            quick_push(a, b);
+            return;
+        }
+        block_set_allocated(b, 0);
+        coalesce(a, b);
+    }
+    trim_heap(a);
+}
+
+/*
+heap_memalign: mm_memalign from arena a; the caller holds a's lock. Takes a
+block large enough to slide the payload up to the next multiple of
+alignment, frees the gap in front of it (which is made at least
+MINBLOCKSIZE so it can stand as a free block) and splits off what is left
+after it.
+returns the payload, or NULL if the heap cannot grow.
+*/
+static void *heap_memalign(arena_t *a, size_t alignment, size_t size) {
+    size_t s = align(size + ALLOC_TAGS_SIZE);
+    if (s < MINBLOCKSIZE) {
+        s = MINBLOCKSIZE;
+    }
+    size_t need = s + alignment + MINBLOCKSIZE;
+    block_t *b = search(a, need);
+    if (b == NULL && quick_flush(a)) {
+        b = search(a, need);
+    }
+    while (b == NULL) {
+        if (extend_heap(a, need) == NULL) {
+            return NULL;
+        }
+        b = search(a, need);
+    }
+
+    uintptr_t payload = (uintptr_t)b->payload;
+    uintptr_t aligned = (payload + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    while (aligned != payload && aligned - payload < MINBLOCKSIZE) {
+        aligned += alignment;
+    }
+    block_t *ab = b;
+    if (aligned != payload) {
+        size_t gap = aligned - payload;
+        ab = (block_t *)((char *)b + gap);
+        block_set_size_and_allocated(ab, block_size(b) - gap, 1);
+        block_set_size_and_allocated(b, gap, 0);
+        coalesce(a, b);
+    }
+    if (isbig(block_size(ab), s) == 1) {
+        size_t leftover = block_size(ab) - s;
+        block_set_size_and_allocated(ab, s, 1);
+        block_t *next = block_next(ab);
+        block_set_size_and_allocated(next, leftover, 0);
+        block_set_prev_allocated(next, 1);
+        coalesce(a, next);
+    }
+    trim_heap(a);
+    return ab->payload;
+}
+
+/*
+heap_calloc: mm_calloc from arena a, for more than SLAB_MAX_SIZE bytes; the
+caller holds a's lock. Only the part of the block below the fresh mark the
+heap had when it was found is cleared.
+returns the payload, or NULL if the heap cannot grow.
+*/
+static void *heap_calloc(arena_t *a, size_t size) {
+    if (size > MAX_HEAP) {
+        return NULL;
+    }
+    size_t s = align(size + ALLOC_TAGS_SIZE);
+    if (++a->mallocs % PROBE_WINDOW == 0) {
+        probe_adapt(a);
+    }
+    if (deferred_mode && s <= QUICK_MAX) {
+        block_t *qb = quick_pop(a, s);
+        if (qb != NULL) {
+            memset(qb->payload, 0, size);
+            return qb->payload;
+        }
+    }
+    char *fresh = a->fresh;
+    block_t *b = search(a, s);
+    if (b == NULL && quick_flush(a)) {
+        b = search(a, s);
+    }
+    if (b == NULL && grower_reclaim(a)) {
+        b = search(a, s);
+    }
+    while (b == NULL) {
+        if (extend_heap(a, s) == NULL) {
+            return NULL;
+        }
+        fresh = a->fresh;
+        b = search(a, s);
+    }
+
+    char *p = (char *)b->payload;
+    char *end = p + size;
+    char *zero = (fresh < p) ? p : (fresh > end) ? end : fresh;
+    memset(p, 0, zero - p);
+#ifdef MM_FOOTERLESS
+    // the last word of the payload may hold the end tag the block had when
+    // it was the free block before the epilogue
+    char *last = (char *)block_next(b) - TAG_SIZE;
+    if (last >= zero && last < end) {
+        memset(last, 0, end - last);
+    }
+#endif
+    return p;
+}
+
+/*
+tail_block: allocates a block of size bytes at the end of arena a's heap,
+in the free block before the epilogue if there is one, moving the break by
+whatever that block is short of.
+returns the block, or NULL if the heap cannot grow.
+*/
+static block_t *tail_block(arena_t *a, size_t size) {
+    block_t *b = a->epil;
+    size_t have = 0;
+    if (!block_prev_allocated(a->epil)) {
+        b = block_prev(a->epil);
+        have = block_size(b);
+    }
+    if (have < size && mem_region_sbrk(a->region, size - have) == (void *)-1) {
+        return NULL;
+    }
+    if (have != 0) {
+        pull_free_block(&a->flist, b);
+    }
+    if (have >= size + MINBLOCKSIZE) {
+        block_set_size_and_allocated(b, size, 1);
+        block_t *rest = block_next(b);
+        block_set_size_and_allocated(rest, have - size, 0);
+        block_set_prev_allocated(rest, 1);
+        insert_free_block(&a->flist, rest);
+        fresh_note(a, b);
+        return b;
+    }
+    block_set_size_and_allocated(b, (have > size) ? have : size, 1);
+    a->epil = block_next(b);
+    block_set_size_and_allocated(a->epil, TAGS_SIZE, 1);
+    block_set_prev_allocated(a->epil, 1);
+    fresh_note(a, b);
+    return b;
+}
+
+/*
+heap_realloc: mm_realloc within arena a, which owns ptr; the caller holds
+a's lock.
+*/
+static void *heap_realloc(arena_t *a, void *ptr, size_t size) {
+    if (size == 0) {
+        heap_free(a, ptr);
+        return NULL;
+    }
+    if (ptr == NULL) {
+        return heap_malloc(a, size);
+    }
+    if (size > MAX_HEAP) {
+        return NULL;
+    }
+    span_t *span = page_span(ptr);
+    if (span->kind == SPAN_RUN) {
+        size_t slot_size = span->slot_size;
+        if (size <= slot_size) {
+            return ptr;
+        }
+        void *moved = heap_malloc(a, size);
+        if (moved == NULL) {
+            return NULL;
+        }
+        memcpy(moved, ptr, slot_size);
+        a->realloc_copied += slot_size;
+        slab_free(a, span->run, ptr);
+        return moved;
+    }
+
+    block_t *ab = payload_to_block(ptr);
+    size_t block_s = align(size + ALLOC_TAGS_SIZE);
+
+    if (block_s <= MINBLOCKSIZE) {
+        block_s = MINBLOCKSIZE;
+    }
+
+    grower_t *g = grower_note(a, ptr, block_s);
+    if (block_s <= block_size(ab)) {
+        if (g->streak > 1) {
+            // still within the headroom given when the block last moved
+            return ptr;
+        }
+        if (isbig(block_size(ab), block_s) == 1) {
+            size_t leftover = block_size(ab) - block_s;
+            block_set_size_and_allocated(ab, block_s, 1);
+            block_t *next = block_next(ab);
+            block_set_size_and_allocated(next, leftover, 0);
+            block_set_prev_allocated(next, 1);
+            coalesce(a, next);
+            trim_heap(a);
+            return ptr;
+        }
+        return ptr;
+    }
+
+    size_t max_s = block_size(ab);
+
+    block_t *prev = ab;
+    if (block_prev_allocated(ab) == 0) {
+        prev = block_prev(ab);
+    }
+    block_t *next = ab;
+    if (block_next_allocated(ab) == 0) {
+        max_s += block_next_size(ab);
+        next = block_next(ab);
+    }
+    // checks to see if nearby free space can fit realloc size
+    int j = isbig(max_s, block_s);
+    if (j == -1) {
+        size_t payload_size = block_size(ab) - ALLOC_TAGS_SIZE;
+        if (block_next(next) == a->epil &&
+            mem_region_sbrk(a->region, block_s - max_s) != (void *)-1) {
+            // the block (and the free block after it, if any) ends the heap:
+            // moving the break by the shortfall extends it in place
+            if (next != ab) {
+                pull_free_block(&a->flist, next);
+            }
+            block_set_size_and_allocated(ab, block_s, 1);
+            a->epil = block_next(ab);
+            block_set_size_and_allocated(a->epil, TAGS_SIZE, 1);
+            block_set_prev_allocated(a->epil, 1);
+            a->realloc_saved += payload_size;
+            fresh_note(a, ab);
+            return ptr;
+        }
+        // a block that keeps growing is given headroom when it moves
+        size_t keep = block_s;
+        if (g->streak >= GROW_STREAK) {
+            keep = align(block_s + block_s / GROW_HEADROOM);
+        }
+        if (prev != ab) {
+            size_t total_size = block_size(prev) + max_s;
+            if (total_size >= block_s) {
+                if (next != ab) {
+                    pull_free_block(&a->flist, next);
+                }
+                if (total_size >= (keep + THRESHOLD)) {
+                    size_t leftover = total_size - keep;
+                    // prev shrinks, so it may belong to a smaller size class
+                    pull_free_block(&a->flist, prev);
+                    block_set_size(prev, leftover);
+                    insert_free_block(&a->flist, prev);
+                    block_t *newblock = block_next(prev);
+                    memmove((newblock->payload), ptr, payload_size);
+                    a->realloc_copied += payload_size;
+                    block_set_size_and_allocated(newblock, keep, 1);
+                    block_set_prev_allocated(newblock, 0);
+                    block_set_prev_allocated(block_next(newblock), 1);
+                    fresh_note(a, newblock);
+                    g->ptr = newblock->payload;
+                    return (newblock->payload);
+                }
+                pull_free_block(&a->flist, prev);
+                memmove((prev->payload), ptr, payload_size);
+                a->realloc_copied += payload_size;
+                block_set_size_and_allocated(prev, total_size, 1);
+                block_set_prev_allocated(block_next(prev), 1);
+                fresh_note(a, prev);
+                g->ptr = prev->payload;
+                return (prev->payload);
+            }
+        }
+        // failing a free block with room for the headroom, a block that keeps
+        // growing goes to the end of the heap, where its next growth is in
+        // place, rather than to wherever an extension leaves it
+        void *fb = NULL;
+        if (g->streak >= GROW_STREAK) {
+            block_t *nb = search(a, keep);
+            if (nb == NULL) {
+                nb = search(a, block_s);
+            }
+            if (nb == NULL) {
+                nb = tail_block(a, block_s);
+            }
+            fb = (nb != NULL) ? nb->payload : NULL;
+        } else {
+            fb = heap_malloc(a, size);
+        }
+        if (fb == NULL) {
+            return NULL;
+        }
+        memcpy(fb, ptr, payload_size);
+        a->realloc_copied += payload_size;
+        int streak = g->streak;
+        heap_free(a, ptr);
+        if (page_span(fb)->kind != SPAN_RUN) {
+            grower_note(a, fb, block_s)->streak = streak;
+        }
+        return fb;
+    } else if (j == 0) {
+        // requested realloc size needs all of the space
+        if (next != ab) {
+            pull_free_block(&a->flist, next);
+        }
+        block_set_size_and_allocated(ab, max_s, 1);
+        block_set_prev_allocated(block_next(ab), 1);
+        fresh_note(a, ab);
+        return ptr;
+    } else if (j == 1) {
+        // fits with splitting on leftover
+        pull_free_block(&a->flist, next);
+        size_t leftover = max_s - block_s;
+        block_set_size(ab, block_s);
+        block_t *adjacent = block_next(ab);
+        block_set_size_and_allocated(adjacent, leftover, 0);
+        block_set_prev_allocated(adjacent, 1);
+        coalesce(a, adjacent);
+        fresh_note(a, ab);
+        return ptr;
+    }
+    return NULL;
+}
+
+// returns 1 if ptr is the payload of a huge block, outside every region
+static inline int is_huge(void *ptr) {
+    return (uintptr_t)ptr - (uintptr_t)mem_heap_lo() >=
+           (uintptr_t)MEM_REGIONS * MAX_HEAP;
+}
+
+// returns the length of the mapping that holds huge block ptr
+static inline size_t huge_length(void *ptr) {
+    return *(size_t *)((char *)ptr - HUGE_HEADER);
+}
+
+// returns the length of the mapping that holds a huge block of size bytes:
+// memlib maps whole system pages, which need not be PAGE_SIZE bytes. returns
+// 0 if the length does not fit in a size_t.
+static inline size_t huge_round(size_t size) {
+    size_t page = mem_pagesize();
+    if (size > SIZE_MAX - HUGE_HEADER - page) {
+        return 0;
+    }
+    return (size + HUGE_HEADER + page - 1) / page * page;
 }
 
 /*
- *                             _       _ _
- *     _ __ ___  _ __ ___     (_)_ __ (_) |_
- *    | '_ ` _ \| '_ ` _ \    | | '_ \| | __|
- *    | | | | | | | | | | |   | | | | | | |_
- *    |_| |_| |_|_| |_| |_|___|_|_| |_|_|\__|
- *                       |_____|
- *
- * initializes the dynamic storage allocator (allocate initial heap space)
- * arguments: none
- * returns: 0, if successful
- *         -1, if an error occurs
- */
-int mm_init(void) {
-    prol = (block_t *)mem_sbrk(2 * TAGS_SIZE);
-    if (prol == (void *)-1) {
+huge_malloc: maps a huge block of at least size bytes.
+returns its payload, or NULL if size is too large or the mapping fails.
+*/
+static void *huge_malloc(size_t size) {
+    size_t length = huge_round(size);
+    if (length == 0) {
+        return NULL;
+    }
+    char *map = mem_map(length);
+    if (map == (void *)-1) {
+        return NULL;
+    }
+    *(size_t *)map = length;
+    return map + HUGE_HEADER;
+}
+
+// unmaps huge block ptr
+static void huge_free(void *ptr) { mem_unmap((char *)ptr - HUGE_HEADER); }
+
+/*
+huge_realloc: resizes huge block ptr to hold size bytes with mem_remap, which
+moves pages instead of copying them.
+returns the payload, which may have moved, or NULL if size is too large or
+the mapping cannot be resized (ptr is left as it was).
+*/
+static void *huge_realloc(void *ptr, size_t size) {
+    size_t length = huge_round(size);
+    if (length == 0) {
+        return NULL;
+    }
+    if (length == huge_length(ptr)) {
+        return ptr;
+    }
+    char *map = mem_remap((char *)ptr - HUGE_HEADER, length);
+    if (map == (void *)-1) {
+        return NULL;
+    }
+    *(size_t *)map = length;
+    return map + HUGE_HEADER;
+}
+
+// returns the arena whose region holds ptr
+static inline arena_t *arena_of(void *ptr) {
+    return &arenas[mem_region_of(ptr)];
+}
+
+/*
+remote_push: pushes the chain of objects from first to last, all owned by
+arena a and linked through their first word, onto a's remote-free stack.
+Safe from any thread without a's lock.
+*/
+static inline void remote_push(arena_t *a, void *first, void *last) {
+    void *head = __atomic_load_n(&a->remote, __ATOMIC_RELAXED);
+    do {
+        *(void **)last = head;
+    } while (!__atomic_compare_exchange_n(&a->remote, &head, first, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/*
+remote_drain: frees everything on a's remote-free stack; the caller holds
+a's lock.
+*/
+static void remote_drain(arena_t *a) {
+    void *obj = __atomic_exchange_n(&a->remote, NULL, __ATOMIC_ACQUIRE);
+    while (obj != NULL) {
+        void *next = *(void **)obj;
+        heap_free(a, obj);
+        obj = next;
+    }
+}
+
+// locks arena a, then frees what other threads queued for it
+static inline void arena_lock(arena_t *a) {
+    pthread_mutex_lock(&a->lock);
+    if (__atomic_load_n(&a->remote, __ATOMIC_RELAXED) != NULL) {
+        remote_drain(a);
+    }
+}
+
+// returns the object a central stack top points to, or NULL
+static inline void *central_obj(uint64_t top) {
+    uint64_t offset = top & CENTRAL_OFFSET;
+    return offset ? (char *)mem_heap_lo() + offset : NULL;
+}
+
+// returns top with its generation bumped, pointing to obj
+static inline uint64_t central_top(uint64_t top, void *obj) {
+    uint64_t offset = obj ? (uint64_t)((char *)obj - (char *)mem_heap_lo()) : 0;
+    return ((top & ~CENTRAL_OFFSET) + CENTRAL_GEN) | offset;
+}
+
+/*
+central_push: pushes the chain of n slab slots of class c from first to
+last, linked through their first word, onto the central stack of class c.
+Safe from any thread without a lock.
+returns 0, or -1 if the stack is full and nothing was pushed.
+*/
+static int central_push(int c, void *first, void *last, unsigned n) {
+    if (__atomic_load_n(&central_count[c], __ATOMIC_RELAXED) >= CENTRAL_LIMIT) {
         return -1;
     }
-    flist_first = NULL;
-    block_set_size_and_allocated(prol, TAGS_SIZE, 1);
-    epil = block_next(prol);
-    block_set_size_and_allocated(epil, TAGS_SIZE, 1);
+    uint64_t top = __atomic_load_n(&central[c], __ATOMIC_RELAXED);
+    do {
+        __atomic_store_n((void **)last, central_obj(top), __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&central[c], &top,
+                                          central_top(top, first), 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    __atomic_fetch_add(&central_count[c], n, __ATOMIC_RELAXED);
     return 0;
 }
 
 /*
-coalesce function, takes in a free block and checks neighbors if their free.
-If so, merges by manipulating block sizes and puts the new block into the list.
+central_pop: takes a slab slot of class c off the central stack. Safe from
+any thread without a lock.
+returns the slot, or NULL if the stack is empty.
 */
-static inline void coalesce(block_t *fb) {
-    size_t s = block_size(fb);
+static void *central_pop(int c) {
+    uint64_t top = __atomic_load_n(&central[c], __ATOMIC_ACQUIRE);
+    void *obj;
+    do {
+        obj = central_obj(top);
+        if (obj == NULL) {
+            return NULL;
+        }
+        // obj may already have been popped and handed out by another thread;
+        // its memory stays mapped, and the generation makes the CAS fail
+    } while (!__atomic_compare_exchange_n(
+        &central[c], &top,
+        central_top(top, __atomic_load_n((void **)obj, __ATOMIC_RELAXED)), 1,
+        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    __atomic_fetch_sub(&central_count[c], 1, __ATOMIC_RELAXED);
+    return obj;
+}
 
-    block_t *b = fb;
-    if (block_prev_allocated(b) == 0) {
-        b = block_prev(b);
-        s += block_size(b);
-        pull_free_block(b);
+/*
+tcache_drain: returns n objects of class c from the cache, to the central
+stack while it has room and to their arenas otherwise. Objects are handed
+back to arenas in runs that belong to one arena: under one lock acquisition
+for the thread's own arena, with one push onto the remote-free stack for
+any other.
+*/
+static void tcache_drain(tcache_t *tc, int c, unsigned n) {
+    if (central_mode && n > 0) {
+        void *first = tc->head[c];
+        void *last = first;
+        for (unsigned k = 1; k < n; k++) {
+            last = *(void **)last;
+        }
+        void *rest = *(void **)last;
+        if (central_push(c, first, last, n) == 0) {
+            tc->head[c] = rest;
+            tc->count[c] -= n;
+            return;
+        }
     }
+    while (n > 0) {
+        void *first = tc->head[c];
+        void *last = first;
+        arena_t *a = arena_of(first);
+        unsigned k = 1;
+        while (k < n && arena_of(*(void **)last) == a) {
+            last = *(void **)last;
+            k++;
+        }
+        tc->head[c] = *(void **)last;
+        tc->count[c] -= k;
+        n -= k;
 
-    block_t *f = fb;
-    if (block_next_allocated(f) == 0) {
-        f = block_next(f);
-        s += block_size(f);
-        pull_free_block(f);
+        if (remote_mode && a != tc->arena) {
+            remote_push(a, first, last);
+            continue;
+        }
+        arena_lock(a);
+        for (void *obj = first; k > 0; k--) {
+            void *next = *(void **)obj;
+            heap_free(a, obj);
+            obj = next;
+        }
+        pthread_mutex_unlock(&a->lock);
     }
-
-    block_set_size_and_allocated(b, s, 0);
-    insert_free_block(b);
 }
 
 /*
-function for extending heap by EXTENSION number of bytes or by size_t size bytes, whichever is larger.
+tcache_exit: thread exit destructor; returns everything left in the
+thread's cache to the heap and takes the thread off its arena.
 */
-static inline block_t *extend_heap(size_t size) {
-    size_t s;
-    if (EXTENSION >= size) {
-        s = EXTENSION;
-    } else {
-        s = size;
+static void tcache_exit(void *arg) {
+    tcache_t *tc = arg;
+    if (tc->epoch != heap_epoch) {
+        return;
     }
-    void *err = mem_sbrk(s);
-    if (err == (void *)-1) {
-        return NULL;
+    for (int c = 0; c < TCACHE_CLASSES; c++) {
+        tcache_drain(tc, c, tc->count[c]);
     }
-    block_set_size_and_allocated(epil, s, 0);
-    epil = block_next(epil);
-    block_set_size_and_allocated(epil, TAGS_SIZE, 1);
-    coalesce(block_prev(epil));
-    return epil;
+    pthread_mutex_lock(&assign_lock);
+    tc->arena->nthreads--;
+    pthread_mutex_unlock(&assign_lock);
+}
+
+static void tcache_key_create(void) {
+    pthread_key_create(&tcache_key, tcache_exit);
 }
 
 /*
-function for checking if the block size is big enough for the
-requested block size.
-returns -1 if block is too small, 0 if all of block must be allocated
-and 1 if only a portion of the block must be allocated.
+arena_assign: picks the arena with the fewest threads for the calling
+thread, setting up its heap if needed.
+returns the arena.
 */
-static inline int isbig(size_t bs, size_t size) {
-    if (bs >= size) {
-        if (bs >= (size + THRESHOLD)) {
-            return 1;
+static arena_t *arena_assign(void) {
+    pthread_mutex_lock(&assign_lock);
+    arena_t *a = &arenas[0];
+    for (int i = 1; i < narenas; i++) {
+        if (!arenas[i].heap && arenas[i].nthreads < a->nthreads) {
+            a = &arenas[i];
         }
-        return 0;
     }
-    return -1;
+    a->nthreads++;
+    pthread_mutex_unlock(&assign_lock);
+
+    pthread_mutex_lock(&a->lock);
+    int ready = a->ready || arena_init(a) == 0;
+    pthread_mutex_unlock(&a->lock);
+    if (!ready) {
+        // the region is out of memory; share arena 0 instead
+        pthread_mutex_lock(&assign_lock);
+        a->nthreads--;
+        a = &arenas[0];
+        a->nthreads++;
+        pthread_mutex_unlock(&assign_lock);
+    }
+    return a;
+}
+
+// returns the calling thread's state, started over if it predates the heap
+static inline tcache_t *tcache_get(void) {
+    if (tcache.epoch != heap_epoch) {
+        memset(&tcache, 0, sizeof(tcache));
+        tcache.epoch = heap_epoch;
+        tcache.arena = arena_assign();
+        pthread_once(&tcache_key_once, tcache_key_create);
+        pthread_setspecific(tcache_key, &tcache);
+    }
+    return &tcache;
 }
 
 /*
-search: a function for looking through flist to identify a free block.
-returns pointer to free block of sufficient size, NULL otherwise.
+tcache_refill: moves up to TCACHE_BATCH objects of class c from the central
+stack, or if it is empty, new ones from the thread's arena, into the cache.
 */
-static inline block_t *search(size_t size) {
-    block_t *fb = flist_first;
-    size_t leftover;
-    block_t *adjacent;
-    do {
-        int j = isbig(block_size(fb), size);
-        if (j > -1) {
-            if (j == 1) {
-                //  ^^ free block has leftover space > MINBLOCKSPACE
-                leftover = block_size(fb) - size;
-                pull_free_block(fb);
-                block_set_size_and_allocated(fb, size, 1);
-                adjacent = block_next(fb);
-                block_set_size_and_allocated(adjacent, leftover, 0);
-                insert_free_block(adjacent);
-                return fb;
-            } else if (j == 0) {
-                //  ^^ free block does not have leftover space > MINBLOCKSPACE
-                pull_free_block(fb);
-                block_set_allocated(fb, 1);
-                return fb;
-            }
+static void tcache_refill(tcache_t *tc, int c) {
+    if (central_mode) {
+        void *obj;
+        while (tc->count[c] < TCACHE_BATCH && (obj = central_pop(c)) != NULL) {
+            *(void **)obj = tc->head[c];
+            tc->head[c] = obj;
+            tc->count[c]++;
         }
-        fb = block_flink(fb);
-    } while (fb != flist_first);
-
-    return NULL;
+        if (tc->head[c] != NULL) {
+            return;
+        }
+    }
+    size_t size = (c + 1) * ALIGNMENT;
+    arena_t *a = tc->arena;
+    arena_lock(a);
+    for (int i = 0; i < TCACHE_BATCH; i++) {
+        void *obj = heap_malloc(a, size);
+        if (obj == NULL) {
+            break;
+        }
+        *(void **)obj = tc->head[c];
+        tc->head[c] = obj;
+        tc->count[c]++;
+    }
+    pthread_mutex_unlock(&a->lock);
 }
 
 /*     _ __ ___  _ __ ___      _ __ ___   __ _| | | ___   ___
@@ -163,34 +1651,33 @@ static inline block_t *search(size_t size) {
  *          is a multiple of ALIGNMENT), or NULL if an error occurred
  */
 void *mm_malloc(size_t size) {
-    // TODO
-    block_t *err;
-    size_t s = align(size) + TAGS_SIZE;
-    if (size == 0) {
-        return NULL;
-    } else {
-        if (flist_first == NULL) {
-            err = extend_heap(s);
-            if (err == NULL) {
-                return NULL;
-            }
+    if (tcache_mode && size > 0 && size <= TCACHE_MAX_SIZE) {
+        tcache_t *tc = tcache_get();
+        int c = align(size) / ALIGNMENT - 1;
+        if (tc->head[c] == NULL) {
+            tcache_refill(tc, c);
         }
-
-        if (s < MINBLOCKSIZE) {
-            s = MINBLOCKSIZE;
+        void *obj = tc->head[c];
+        if (obj != NULL) {
+            tc->head[c] = *(void **)obj;
+            tc->count[c]--;
         }
-
-        block_t *fb = search(s);
-        while (fb == NULL) {
-            err = extend_heap(s);
-            if (err == NULL) {
-                return NULL;
-            }
-            fb = search(s);
+        return obj;
+    }
+    if (mmap_threshold && size >= mmap_threshold) {
+        return huge_malloc(size);
+    }
+    if (central_mode && size > 0 && size <= SLAB_MAX_SIZE) {
+        void *obj = central_pop(align(size) / ALIGNMENT - 1);
+        if (obj != NULL) {
+            return obj;
         }
-        return (fb->payload);
     }
-    return NULL;
+    arena_t *a = tcache_get()->arena;
+    arena_lock(a);
+    void *p = heap_malloc(a, size);
+    pthread_mutex_unlock(&a->lock);
+    return p;
 }
 
 /*                              __
@@ -205,10 +1692,36 @@ void *mm_malloc(size_t size) {
  * returns: nothing
  */
 void mm_free(void *ptr) {
-    // TODO
-    block_t *b = payload_to_block(ptr);
-    block_set_allocated(b, 0);
-    coalesce(b);
+    if (is_huge(ptr)) {
+        huge_free(ptr);
+        return;
+    }
+    // only slots are cached: their size comes from the page map, which does
+    // not change while the slot is allocated, whereas block headers can be
+    // rewritten by the neighbours under the arena lock
+    span_t *span = page_span(ptr);
+    if (tcache_mode && span->kind == SPAN_RUN) {
+        tcache_t *tc = tcache_get();
+        int c = span->slot_size / ALIGNMENT - 1;
+        *(void **)ptr = tc->head[c];
+        tc->head[c] = ptr;
+        if (++tc->count[c] >= TCACHE_LIMIT) {
+            tcache_drain(tc, c, TCACHE_BATCH);
+        }
+        return;
+    }
+    if (central_mode && span->kind == SPAN_RUN &&
+        central_push(span->slot_size / ALIGNMENT - 1, ptr, ptr, 1) == 0) {
+        return;
+    }
+    arena_t *a = arena_of(ptr);
+    if (remote_mode && a != tcache_get()->arena) {
+        remote_push(a, ptr, ptr);
+        return;
+    }
+    arena_lock(a);
+    heap_free(a, ptr);
+    pthread_mutex_unlock(&a->lock);
 }
 
 /*
@@ -232,82 +1745,185 @@ void *mm_realloc(void *ptr, size_t size) {
     if (ptr == NULL) {
         return mm_malloc(size);
     }
+    if (is_huge(ptr)) {
+        return huge_realloc(ptr, size);
+    }
+    span_t *span = page_span(ptr);
+    if (span->kind == SPAN_RUN && size <= span->slot_size) {
+        return ptr;
+    }
+    arena_t *a = arena_of(ptr);
+    arena_lock(a);
+    size_t old = span->kind == SPAN_RUN
+                     ? span->slot_size
+                     : block_size(payload_to_block(ptr)) - ALLOC_TAGS_SIZE;
+    if (!mmap_threshold || size < mmap_threshold || size <= old) {
+        // a heap block that shrinks, even one that is still huge (grown
+        // with headroom or memaligned), is split in place
+        void *p = heap_realloc(a, ptr, size);
+        pthread_mutex_unlock(&a->lock);
+        return p;
+    }
+    pthread_mutex_unlock(&a->lock);
+    // a block that outgrows the heap moves to a mapping, where later growth
+    // is a remap instead of another copy
+    void *p = huge_malloc(size);
+    if (p != NULL) {
+        size_t n = (old < size) ? old : size;
+        arena_lock(a);
+        memcpy(p, ptr, n);
+        a->realloc_copied += n;
+        heap_free(a, ptr);
+        pthread_mutex_unlock(&a->lock);
+    }
+    return p;
+}
 
-    block_t *ab = payload_to_block(ptr);
-    size = align(size);
-    size_t block_s = size + TAGS_SIZE;
+/*
+mm_memalign: allocates a block whose payload is a multiple of alignment, a
+power of two; alignments of up to ALIGNMENT are mm_malloc. The block is
+carved from the heap whatever its size, never from a run or a mapping.
+mm_free frees it like any other block. mm_realloc shrinks it in place, but
+a block that grows may move, to the heap or a mapping, and lose the
+alignment.
+returns the payload, or NULL if size is 0, alignment is not a power of two,
+the block heap_memalign looks for would not fit in a size_t, or the heap
+cannot grow.
+*/
+void *mm_memalign(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1))) {
+        return NULL;
+    }
+    if (alignment <= ALIGNMENT) {
+        return mm_malloc(size);
+    }
+    // heap_memalign searches for align(size + ALLOC_TAGS_SIZE) + alignment
+    // + MINBLOCKSIZE bytes; alignment is at most half of SIZE_MAX + 1
+    if (size == 0 || size > SIZE_MAX - alignment - ALLOC_TAGS_SIZE -
+                                WORD_SIZE - MINBLOCKSIZE) {
+        return NULL;
+    }
+    arena_t *a = tcache_get()->arena;
+    arena_lock(a);
+    void *p = heap_memalign(a, alignment, size);
+    pthread_mutex_unlock(&a->lock);
+    return p;
+}
 
-    if (block_s <= MINBLOCKSIZE) {
-        block_s = MINBLOCKSIZE;
+/*
+mm_calloc: allocates a block for nmemb objects of size bytes, all zero.
+Mappings and memory the heap has not handed out since memlib added it are
+zero already, so only the rest of the block is cleared.
+returns the payload, or NULL if the request is 0 bytes or overflows, or
+the heap cannot grow.
+*/
+void *mm_calloc(size_t nmemb, size_t size) {
+    if (size != 0 && nmemb > SIZE_MAX / size) {
+        return NULL;
+    }
+    size_t total = nmemb * size;
+    if (mmap_threshold && total >= mmap_threshold) {
+        return huge_malloc(total);
+    }
+    if (total <= SLAB_MAX_SIZE) {
+        void *p = mm_malloc(total);
+        if (p != NULL) {
+            memset(p, 0, total);
+        }
+        return p;
     }
+    arena_t *a = tcache_get()->arena;
+    arena_lock(a);
+    void *p = heap_calloc(a, total);
+    pthread_mutex_unlock(&a->lock);
+    return p;
+}
 
-    if (block_s <= block_size(ab)) {
-        if (isbig(block_size(ab), block_s) == 1) {
-            size_t leftover = block_size(ab) - block_s;
-            block_set_size_and_allocated(ab, block_s, 1);
-            block_t *next = block_next(ab);
-            block_set_size_and_allocated(next, leftover, 0);
-            mm_free((next->payload));
-            return ptr;
+/*
+mm_heap_create: sets up a separate heap in the highest region that no
+thread has used since mm_init.
+returns the heap, or NULL if every region is taken or cannot grow.
+*/
+mm_heap_t *mm_heap_create(void) {
+    arena_t *a = NULL;
+    pthread_mutex_lock(&assign_lock);
+    for (int i = MEM_REGIONS - 1; i > 0; i--) {
+        if (!arenas[i].heap && !arenas[i].ready && arenas[i].nthreads == 0) {
+            a = &arenas[i];
+            a->heap = 1;
+            break;
         }
-        return ptr;
     }
+    pthread_mutex_unlock(&assign_lock);
+    if (a == NULL) {
+        return NULL;
+    }
+    pthread_mutex_lock(&a->lock);
+    int err = arena_init(a);
+    pthread_mutex_unlock(&a->lock);
+    if (err < 0) {
+        pthread_mutex_lock(&assign_lock);
+        a->heap = 0;
+        pthread_mutex_unlock(&assign_lock);
+        return NULL;
+    }
+    return a;
+}
 
-    size_t max_s = block_size(ab);
+/*
+mm_heap_malloc: mm_malloc from heap, which keeps even huge blocks in its
+region.
+returns the payload, or NULL if size is 0 or the heap cannot grow.
+*/
+void *mm_heap_malloc(mm_heap_t *heap, size_t size) {
+    pthread_mutex_lock(&heap->lock);
+    void *p = heap_malloc(heap, size);
+    pthread_mutex_unlock(&heap->lock);
+    return p;
+}
 
-    block_t *prev = ab;
-    if (block_prev_allocated(ab) == 0) {
-        prev = block_prev(ab);
+// mm_free for ptr, a block of heap
+void mm_heap_free(mm_heap_t *heap, void *ptr) {
+    if (ptr == NULL) {
+        return;
     }
-    block_t *next = ab;
-    if (block_next_allocated(ab) == 0) {
-        max_s += block_next_size(ab);
-        next = block_next(ab);
+    pthread_mutex_lock(&heap->lock);
+    heap_free(heap, ptr);
+    pthread_mutex_unlock(&heap->lock);
+}
+
+/*
+mm_heap_realloc: mm_realloc for ptr, a block of heap, or NULL.
+returns the payload, which may have moved, or NULL if size is 0 or the heap
+cannot grow (ptr is left as it was).
+*/
+void *mm_heap_realloc(mm_heap_t *heap, void *ptr, size_t size) {
+    if (size == 0) {
+        mm_heap_free(heap, ptr);
+        return NULL;
     }
-    // checks to see if nearby free space can fit realloc size
-    int j = isbig(max_s, block_s);
-    if (j == -1) {
-        size_t payload_size = block_size(ab) - TAGS_SIZE;
-        if (prev != ab) {
-            size_t total_size = block_size(prev) + max_s;
-            if (total_size >= block_s) {
-                if (next != ab) {
-                    pull_free_block(next);
-                }
-                if (total_size >= (block_s + THRESHOLD)) {
-                    size_t leftover = total_size - block_s;
-                    block_set_size(prev, leftover);
-                    block_t *newblock = block_next(prev);
-                    memmove((newblock->payload), ptr, payload_size);
-                    block_set_size_and_allocated(newblock, block_s, 1);
-                    return (newblock->payload);
-                }
-                pull_free_block(prev);
-                memmove((prev->payload), ptr, payload_size);
-                block_set_size_and_allocated(prev, total_size, 1);
-                return (prev->payload);
-            }
-        }
-        block_t *fb = mm_malloc(size);
-        memcpy(fb, ptr, payload_size);
-        mm_free(ptr);
-        return fb;
-    } else if (j == 0) {
-        // requested realloc size needs all of the space
-        if (next != ab) {
-            pull_free_block(next);
-        }
-        block_set_size_and_allocated(ab, max_s, 1);
-        return ptr;
-    } else if (j == 1) {
-        // fits with splitting on leftover
-        pull_free_block(next);
-        size_t leftover = max_s - block_s;
-        block_set_size(ab, block_s);
-        block_t *adjacent = block_next(ab);
-        block_set_size_and_allocated(adjacent, leftover, 0);
-        coalesce(adjacent);
-        return ptr;
+    if (ptr == NULL) {
+        return mm_heap_malloc(heap, size);
     }
-    return NULL;
-}
\ No newline at end of file
+    pthread_mutex_lock(&heap->lock);
+    void *p = heap_realloc(heap, ptr, size);
+    pthread_mutex_unlock(&heap->lock);
+    return p;
+}
+
+/*
+mm_heap_destroy: frees every block of heap at once by moving its region's
+break back to the start, and gives the region back to mm_heap_create and
+the threads. The region's page map entries are cleared when it is next set
+up.
+*/
+void mm_heap_destroy(mm_heap_t *heap) {
+    pthread_mutex_lock(&heap->lock);
+    mem_region_reset(heap->region);
+    heap->ready = 0;
+    heap->remote = NULL;
+    pthread_mutex_unlock(&heap->lock);
+    pthread_mutex_lock(&assign_lock);
+    heap->heap = 0;
+    pthread_mutex_unlock(&assign_lock);
+}
@@ -1,39 +1,148 @@
 #ifndef MM_H_
 #define MM_H_
 
+#include <stdint.h>
 #include <stdio.h>
 
 int mm_init(void);
 void *mm_malloc(size_t size);
 void mm_free(void *ptr);
 void *mm_realloc(void *ptr, size_t size);
+// mm_malloc for a payload that starts at a multiple of alignment, a power of
+// two; the slack in front of the block goes back to the free lists
+void *mm_memalign(size_t alignment, size_t size);
+// mm_malloc for nmemb zeroed objects of size bytes; memory the heap has not
+// handed out since it grew is known to be zero and is not cleared again
+void *mm_calloc(size_t nmemb, size_t size);
+
+// A heap of its own for one tenant or subsystem: a separate arena that
+// threads are never assigned to, so its fragmentation is its own, and that
+// mm_heap_destroy empties in constant time, freeing all of its blocks. A heap
+// takes one of the MEM_REGIONS regions that no thread has used since mm_init;
+// mm_heap_create returns NULL if none is left. Blocks of a heap must be freed
+// and resized with mm_heap_free and mm_heap_realloc, never mm_free or
+// mm_realloc, and stay in the heap however large they are. The calls are
+// thread-safe. mm_init drops every heap.
+typedef struct arena mm_heap_t;
+mm_heap_t *mm_heap_create(void);
+void *mm_heap_malloc(mm_heap_t *heap, size_t size);
+void mm_heap_free(mm_heap_t *heap, void *ptr);
+void *mm_heap_realloc(mm_heap_t *heap, void *ptr, size_t size);
+void mm_heap_destroy(mm_heap_t *heap);
+
+// Free block indexes that mm_malloc can search for a fit:
+//     MM_INDEX_SEGLIST: segregated lists, one per size class (default)
+//     MM_INDEX_TLSF: two-level segregated fit; bitmaps find a non-empty list
+//                    in constant time, independent of the number of blocks
+typedef enum { MM_INDEX_SEGLIST, MM_INDEX_TLSF } mm_index_t;
+void mm_set_index(mm_index_t index);
+// How mm_malloc picks a block from a segregated list (MM_INDEX_SEGLIST;
+// blocks of 1 KB or more are always taken best fit from a tree):
+//     MM_FIT_FIRST: the first block that fits (default)
+//     MM_FIT_NEXT: the first that fits after the last one taken, if any
+//     MM_FIT_BEST: the smallest block that fits
+//     MM_FIT_GOOD: the smallest that fits among the first few looked at
+typedef enum { MM_FIT_FIRST, MM_FIT_NEXT, MM_FIT_BEST, MM_FIT_GOOD } mm_fit_t;
+void mm_set_fit(mm_fit_t fit);
+// Where mm_free inserts a block into its segregated list:
+//     MM_ORDER_LIFO: at the head (default)
+//     MM_ORDER_ADDRESS: in address order, so searches find low blocks first
+typedef enum { MM_ORDER_LIFO, MM_ORDER_ADDRESS } mm_order_t;
+void mm_set_order(mm_order_t order);
+// Requests of up to 128 bytes are served from page-sized runs of equal slots
+// that carry no tags (on by default)
+void mm_set_slab(int enabled);
+// mm_malloc, mm_free and mm_realloc are thread-safe. Each thread caches small
+// freed objects so most of its calls skip the heap lock (on by default).
+void mm_set_tcache(int enabled);
+// Threads are spread over n separate arenas, each with its own heap and lock
+// (n is at most, and by default, MEM_REGIONS from memlib.h)
+void mm_set_arenas(int n);
+// A thread freeing another arena's object pushes it onto that arena's
+// lock-free remote-free stack, which the owner frees in batches (on by
+// default); when off, the freeing thread takes the owner's lock
+void mm_set_remote_free(int enabled);
+// Small freed objects are also kept on lock-free stacks, one per size,
+// shared by all threads, that caches refill from and drain into before
+// taking an arena lock (on by default)
+void mm_set_central(int enabled);
+// Once the free block at the end of a heap grows past threshold bytes (128 KB
+// by default), the heap is trimmed and the memory given back to memlib;
+// 0 never trims
+void mm_set_trim(size_t threshold);
+// Requests of at least threshold bytes (128 KB by default) get their own
+// mapping from memlib instead of a heap block; mm_free unmaps it and
+// mm_realloc resizes it without copying. 0 keeps every request in the heap.
+void mm_set_mmap_threshold(size_t threshold);
+// Freed blocks of up to 1 KB are kept on quick lists, one per exact size,
+// for the next malloc of that size, and only coalesced in a batch when a
+// search fails or the lists grow past a budget (off by default)
+void mm_set_deferred(int enabled);
+// Blocks of less than 512 bytes are carved from the high end of a free block
+// and larger ones from the low end (off by default)
+void mm_set_split(int enabled);
+
+// Counters kept since the last mm_init
+typedef struct {
+  size_t realloc_copied;  // payload bytes mm_realloc copied to move blocks
+  size_t realloc_saved;   // payload bytes it did not copy because it grew
+                          // a block at the end of the heap in place
+  unsigned search_max;    // most free blocks one search of a segregated
+                          // list looked at
+} mm_counters_t;
+void mm_get_counters(mm_counters_t *c);
 
 // Defines alignment to 8 bytes.
 #define ALIGNMENT 8
 // Size of a memory address, which in this case is 8 bytes
 // in a 64-bit system.
 #define WORD_SIZE (sizeof(size_t))
+// Type of a boundary tag. With MM_COMPACT, tags are 32 bits and free list
+// links are stored as 32-bit offsets from mem_heap_lo(), which is enough for
+// MAX_HEAP and halves the minimum block size.
+#ifdef MM_COMPACT
+typedef uint32_t tag_t;
+#else
+typedef size_t tag_t;
+#endif
+// Size of one tag (WORD_SIZE unless MM_COMPACT)
+#define TAG_SIZE (sizeof(tag_t))
 // Sum of the sizes of the beginning and end tags of a block.
-// (Each tag's size is WORD_SIZE)
-#define TAGS_SIZE (2 * WORD_SIZE)
+// (Each tag's size is TAG_SIZE)
+#define TAGS_SIZE (2 * TAG_SIZE)
+// Bytes of tags carried by an allocated block. With MM_FOOTERLESS, allocated
+// blocks keep only their header: a bit in the next block's header records
+// that they are allocated, and only free blocks keep an end tag (which
+// coalescing needs to find the start of the previous block).
+#ifdef MM_FOOTERLESS
+#define ALLOC_TAGS_SIZE TAG_SIZE
+#else
+#define ALLOC_TAGS_SIZE TAGS_SIZE
+#endif
 // Minimum size of a block. Your implementation should make
 // sure no allocated or free block has a size of less than
-// this constant.
-#define MINBLOCKSIZE (4 * WORD_SIZE)
+// this constant. (A free block needs a header, flink, blink and end tag.)
+#define MINBLOCKSIZE (4 * TAG_SIZE)
+// Bytes skipped at the start of the heap so that payloads, which follow a
+// TAG_SIZE header, land on an ALIGNMENT boundary
+#define HEAP_PAD ((ALIGNMENT - TAG_SIZE) % ALIGNMENT)
 
 typedef struct block {
-  size_t size;
+  tag_t size;
   // size field represents the size of the block
   // size is assumed to be a multiple of 8. The least-significant bit is
   // overloaded:
   //     if 0 the block is free
   //     if 1 the block is allocated
-  size_t payload[];
+  // with MM_FOOTERLESS, the second bit is set iff the previous block is
+  // allocated
+  tag_t payload[];
 
   // for free blocks:
   //     payload[0] is the block's flink (points to the next block in the free list);
   //     payload[1] is the block's blink (points to the previous block in the free list)
   // there is a copy of the size field at the end of the block
+  // (with MM_FOOTERLESS, only at the end of free blocks)
 } block_t;
 
 #endif  // MM_H_
@@ -0,0 +1,439 @@
+/*
+ * mmbench - multi-threaded benchmarks for the mm.c allocator
+ *
+ * Each benchmark runs the same workload with 1, 2, ... up to the maximum
+ * number of threads and prints the throughput of every step. Unlike mdriver,
+ * which replays traces in a single thread, mmbench measures how well
+ * mm_malloc and mm_free scale when threads use the allocator at once.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "memlib.h"
+#include "mm.h"
+#include "mmpool.h"
+
+#define SLOTS 256 /* live objects per thread */
+#define RING 1024 /* capacity of a thread's inbox */
+
+/* Per-thread workload parameters */
+typedef struct {
+    unsigned seed;
+    long ops;     /* malloc/free pairs to perform */
+    int id;       /* 0 .. nthreads - 1 */
+    int nthreads; /* threads running the workload */
+} worker_t;
+
+/* Single-producer, single-consumer queue of objects to free */
+typedef struct {
+    void *objs[RING];
+    unsigned long head; /* next slot to take, advanced by the consumer */
+    unsigned long tail; /* next slot to fill, advanced by the producer */
+    int done;           /* set once the producer has stopped */
+} inbox_t;
+
+static long num_ops = 1000000; /* malloc/free pairs per thread */
+static int max_threads = 8;
+static int remote_pct; /* bench_remote: % of objects freed by another thread */
+static inbox_t *inboxes; /* bench_remote: one per thread */
+static size_t fixed_size; /* bench_pool: size of every object */
+
+static void usage(void);
+
+/*
+ * scaling_worker - allocates and frees objects of 8 to 128 bytes, keeping
+ * about SLOTS of them alive, and writes to every object it allocates
+ */
+static void *scaling_worker(void *arg) {
+    worker_t *w = arg;
+    char *live[SLOTS] = {NULL};
+
+    for (long i = 0; i < w->ops; i++) {
+        int s = rand_r(&w->seed) % SLOTS;
+        if (live[s] != NULL) {
+            mm_free(live[s]);
+        }
+        size_t size = 8 + rand_r(&w->seed) % 121;
+        live[s] = mm_malloc(size);
+        if (live[s] == NULL) {
+            fprintf(stderr, "mmbench: mm_malloc(%zu) failed\n", size);
+            exit(1);
+        }
+        live[s][0] = (char)i;
+    }
+    for (int s = 0; s < SLOTS; s++) {
+        if (live[s] != NULL) {
+            mm_free(live[s]);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * fixed_churn - allocates and frees objects of fixed_size bytes, keeping
+ * about SLOTS of them alive, from pool if it is not NULL and with mm_malloc
+ * otherwise
+ */
+static void fixed_churn(worker_t *w, mm_pool_t *pool) {
+    char *live[SLOTS] = {NULL};
+
+    for (long i = 0; i < w->ops; i++) {
+        int s = rand_r(&w->seed) % SLOTS;
+        if (live[s] != NULL) {
+            if (pool != NULL) {
+                mm_pool_free(pool, live[s]);
+            } else {
+                mm_free(live[s]);
+            }
+        }
+        live[s] = (pool != NULL) ? mm_pool_alloc(pool) : mm_malloc(fixed_size);
+        if (live[s] == NULL) {
+            fprintf(stderr, "mmbench: allocating %zu bytes failed\n",
+                    fixed_size);
+            exit(1);
+        }
+        live[s][0] = (char)i;
+    }
+    for (int s = 0; s < SLOTS && pool == NULL; s++) {
+        if (live[s] != NULL) {
+            mm_free(live[s]);
+        }
+    }
+}
+
+/* fixed_worker - fixed_churn with mm_malloc and mm_free */
+static void *fixed_worker(void *arg) {
+    fixed_churn(arg, NULL);
+    return NULL;
+}
+
+/* pool_worker - fixed_churn through a pool of the thread's own */
+static void *pool_worker(void *arg) {
+    mm_pool_t *pool = mm_pool_create(fixed_size);
+    if (pool == NULL) {
+        fprintf(stderr, "mmbench: mm_pool_create failed\n");
+        exit(1);
+    }
+    fixed_churn(arg, pool);
+    mm_pool_destroy(pool);
+    return NULL;
+}
+
+/*
+ * run_threads - starts nthreads copies of fn on a fresh heap and returns the
+ * wall-clock seconds until all of them have finished
+ */
+static double run_threads(void *(*fn)(void *), int nthreads) {
+    pthread_t tids[nthreads];
+    worker_t workers[nthreads];
+    struct timespec start, end;
+
+    mem_reset_brk();
+    if (mm_init() < 0) {
+        fprintf(stderr, "mmbench: mm_init failed\n");
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int t = 0; t < nthreads; t++) {
+        workers[t].seed = t + 1;
+        workers[t].ops = num_ops;
+        workers[t].id = t;
+        workers[t].nthreads = nthreads;
+        pthread_create(&tids[t], NULL, fn, &workers[t]);
+    }
+    for (int t = 0; t < nthreads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+/*
+ * inbox_drain - frees every object waiting in inbox; returns how many
+ */
+static long inbox_drain(inbox_t *inbox) {
+    unsigned long head = inbox->head;
+    unsigned long tail = __atomic_load_n(&inbox->tail, __ATOMIC_ACQUIRE);
+    for (unsigned long i = head; i < tail; i++) {
+        mm_free(inbox->objs[i % RING]);
+    }
+    __atomic_store_n(&inbox->head, tail, __ATOMIC_RELEASE);
+    return tail - head;
+}
+
+/*
+ * remote_worker - allocates objects of 8 to 512 bytes and hands remote_pct
+ * percent of them to the next thread to free, freeing the rest itself
+ */
+static void *remote_worker(void *arg) {
+    worker_t *w = arg;
+    inbox_t *in = &inboxes[w->id];
+    inbox_t *out = &inboxes[(w->id + 1) % w->nthreads];
+    char *live[SLOTS] = {NULL};
+
+    for (long i = 0; i < w->ops; i++) {
+        if ((i & 63) == 0) {
+            inbox_drain(in);
+        }
+        size_t size = 8 + rand_r(&w->seed) % 505;
+        char *p = mm_malloc(size);
+        if (p == NULL) {
+            fprintf(stderr, "mmbench: mm_malloc(%zu) failed\n", size);
+            exit(1);
+        }
+        p[0] = (char)i;
+        unsigned long head = __atomic_load_n(&out->head, __ATOMIC_ACQUIRE);
+        if ((int)(rand_r(&w->seed) % 100) < remote_pct &&
+            out->tail - head < RING) {
+            out->objs[out->tail % RING] = p;
+            __atomic_store_n(&out->tail, out->tail + 1, __ATOMIC_RELEASE);
+            continue;
+        }
+        int s = rand_r(&w->seed) % SLOTS;
+        if (live[s] != NULL) {
+            mm_free(live[s]);
+        }
+        live[s] = (char *)p;
+    }
+    for (int s = 0; s < SLOTS; s++) {
+        if (live[s] != NULL) {
+            mm_free(live[s]);
+        }
+    }
+    __atomic_store_n(&out->done, 1, __ATOMIC_RELEASE);
+    while (!__atomic_load_n(&in->done, __ATOMIC_ACQUIRE)) {
+        if (inbox_drain(in) == 0) {
+            sched_yield();
+        }
+    }
+    inbox_drain(in);
+    return NULL;
+}
+
+/*
+ * bench_remote - throughput of max_threads threads (at least 2) as the
+ * share of objects freed by a thread other than the allocating one grows
+ * from 0% to 100%, with and without the remote-free stacks
+ */
+static void bench_remote(void) {
+    int n = (max_threads < 2) ? 2 : max_threads;
+    inboxes = malloc(n * sizeof(inbox_t));
+    if (inboxes == NULL) {
+        fprintf(stderr, "mmbench: malloc failed\n");
+        exit(1);
+    }
+
+    printf("remote: %d threads, %ld mallocs per thread\n", n, num_ops);
+    printf(" remote  remote-free Mops/s   locked Mops/s\n");
+    for (remote_pct = 0; remote_pct <= 100; remote_pct += 25) {
+        double mops[2];
+        for (int queued = 1; queued >= 0; queued--) {
+            memset(inboxes, 0, n * sizeof(inbox_t));
+            mm_set_remote_free(queued);
+            mops[queued] = n * num_ops / run_threads(remote_worker, n) / 1e6;
+        }
+        printf("%6d%%  %19.2f  %14.2f\n", remote_pct, mops[1], mops[0]);
+    }
+    mm_set_remote_free(1);
+    free(inboxes);
+}
+
+/* An allocator configuration to benchmark */
+typedef struct {
+    const char *name;
+    int arenas;
+    int tcache;
+    int central;
+    int slab;
+} config_t;
+
+/* Configurations that bench_scaling compares */
+static const config_t scaling_configs[] = {
+    {"arenas+tcache", MEM_REGIONS, 1, 1, 1},
+    {"arenas", MEM_REGIONS, 0, 0, 1},
+    {"1 arena", 1, 0, 0, 1},
+};
+
+/*
+ * Configurations that bench_contention compares: every thread shares one
+ * arena and no thread caches, so small objects go either through the
+ * central lock-free stacks or through the arena's mutex, to its runs or,
+ * without runs, to its boundary-tag free lists (flist_find)
+ */
+static const config_t contention_configs[] = {
+    {"lock-free stacks", 1, 0, 1, 1},
+    {"mutex+runs", 1, 0, 0, 1},
+    {"mutex+free list", 1, 0, 0, 0},
+};
+
+#define NUM_CONFIGS(configs) (int)(sizeof(configs) / sizeof(configs[0]))
+
+/*
+ * contention_worker - allocates and frees 64-byte objects, keeping 8 of
+ * them alive, so that all threads hit the same size class
+ */
+static void *contention_worker(void *arg) {
+    worker_t *w = arg;
+    char *live[8] = {NULL};
+
+    for (long i = 0; i < w->ops; i++) {
+        int s = i & 7;
+        if (live[s] != NULL) {
+            mm_free(live[s]);
+        }
+        live[s] = mm_malloc(64);
+        if (live[s] == NULL) {
+            fprintf(stderr, "mmbench: mm_malloc(64) failed\n");
+            exit(1);
+        }
+        live[s][0] = (char)i;
+    }
+    for (int s = 0; s < 8; s++) {
+        if (live[s] != NULL) {
+            mm_free(live[s]);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * bench_configs - throughput of fn from 1 to max_threads threads, in Mops/s
+ * and as a speedup over one thread, for each of the n configurations
+ */
+static void bench_configs(const config_t *configs, int n, void *(*fn)(void *)) {
+    double base[n];
+
+    printf("threads");
+    for (int k = 0; k < n; k++) {
+        printf("  %22s", configs[k].name);
+    }
+    printf("\n");
+    for (int t = 1; t <= max_threads; t++) {
+        printf("%7d", t);
+        for (int k = 0; k < n; k++) {
+            mm_set_arenas(configs[k].arenas);
+            mm_set_tcache(configs[k].tcache);
+            mm_set_central(configs[k].central);
+            mm_set_slab(configs[k].slab);
+            double mops = t * num_ops / run_threads(fn, t) / 1e6;
+            if (t == 1) {
+                base[k] = mops;
+            }
+            printf("  %7.2f Mops/s %6.2fx", mops, mops / base[k]);
+        }
+        printf("\n");
+    }
+    mm_set_arenas(MEM_REGIONS);
+    mm_set_tcache(1);
+    mm_set_central(1);
+    mm_set_slab(1);
+}
+
+/*
+ * bench_scaling - throughput of small malloc/free pairs with the caches
+ * and arenas, with arenas only, and with a single arena
+ */
+static void bench_scaling(void) {
+    printf("scaling: %ld malloc/free pairs per thread\n", num_ops);
+    bench_configs(scaling_configs, NUM_CONFIGS(scaling_configs),
+                  scaling_worker);
+}
+
+/*
+ * bench_contention - throughput of malloc/free pairs of one size on a
+ * single shared arena, through the lock-free stacks or under the mutex
+ */
+static void bench_contention(void) {
+    printf("contention: %ld malloc/free pairs per thread\n", num_ops);
+    bench_configs(contention_configs, NUM_CONFIGS(contention_configs),
+                  contention_worker);
+}
+
+/*
+ * bench_pool - throughput of malloc/free pairs of one size, with mm_malloc
+ * and mm_free and through per-thread pools, for a slab-sized, a small
+ * boundary-tag and a larger object
+ */
+static void bench_pool(void) {
+    static const size_t sizes[] = {48, 256, 1024};
+
+    printf("pool: %ld alloc/free pairs per thread\n", num_ops);
+    printf("   size  threads  mm_malloc Mops/s  pool Mops/s  speedup\n");
+    for (int k = 0; k < (int)(sizeof(sizes) / sizeof(sizes[0])); k++) {
+        fixed_size = sizes[k];
+        for (int t = 1; t <= max_threads; t *= 2) {
+            double raw = t * num_ops / run_threads(fixed_worker, t) / 1e6;
+            double pooled = t * num_ops / run_threads(pool_worker, t) / 1e6;
+            printf("%7zu  %7d  %16.2f  %11.2f  %6.2fx\n", fixed_size, t, raw,
+                   pooled, pooled / raw);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    int c;
+    char *bench = "all";
+    while ((c = getopt(argc, argv, "b:n:t:h")) != EOF) {
+        switch (c) {
+            case 'b': /* benchmark to run */
+                bench = optarg;
+                break;
+            case 'n': /* malloc/free pairs per thread */
+                num_ops = atol(optarg);
+                break;
+            case 't': /* largest number of threads */
+                max_threads = atoi(optarg);
+                break;
+            case 'h':
+                usage();
+                exit(0);
+            default:
+                usage();
+                exit(1);
+        }
+    }
+    int all = !strcmp(bench, "all");
+    if (num_ops <= 0 || max_threads <= 0 ||
+        !(all || !strcmp(bench, "scaling") || !strcmp(bench, "remote") ||
+          !strcmp(bench, "contention") || !strcmp(bench, "pool"))) {
+        usage();
+        exit(1);
+    }
+
+    mem_init();
+    if (all || !strcmp(bench, "scaling")) {
+        bench_scaling();
+    }
+    if (all || !strcmp(bench, "remote")) {
+        bench_remote();
+    }
+    if (all || !strcmp(bench, "contention")) {
+        bench_contention();
+    }
+    if (all || !strcmp(bench, "pool")) {
+        bench_pool();
+    }
+    mem_deinit();
+    return 0;
+}
+
+/*
+ * usage - Explain the command line arguments
+ */
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: mmbench [-h] [-b <bench>] [-n <ops>] [-t <threads>]\n");
+    fprintf(stderr, "Options\n");
+    fprintf(stderr,
+            "\t-b <bench>   Benchmark: scaling, remote, contention, pool or "
+            "all (default).\n");
+    fprintf(stderr, "\t-h           Print this message.\n");
+    fprintf(stderr,
+            "\t-n <ops>     malloc/free pairs per thread (default 1000000).\n");
+    fprintf(stderr, "\t-t <threads> Largest number of threads (default 8).\n");
+}
@@ -3,39 +3,91 @@
 // This file defines inline functions to manipulate blocks and the free list
 // NOTE: to be included only in mm.c
 
-static block_t *flist_first;  // head of circular, doubly linked free list
+// Free blocks are kept on segregated, circular, doubly linked lists, one per
+// size class. Classes below SMALL_CLASS_MAX hold a single block size each
+// (ALIGNMENT apart); above that each class covers a power-of-two range.
+#define SMALL_CLASS_MAX 128
+#define NUM_SMALL_CLASSES (((SMALL_CLASS_MAX - MINBLOCKSIZE) / ALIGNMENT) + 1)
+#define NUM_SIZE_CLASSES 32
+
+// With MM_INDEX_TLSF the free blocks are instead indexed two-level
+// segregated fit style: a first level of power-of-two ranges, each split
+// into TLSF_SL_COUNT linear second-level lists. Sizes below TLSF_SMALL_MAX
+// all share first-level list 0, spaced ALIGNMENT apart.
+#define TLSF_SL_LOG2 4
+#define TLSF_SL_COUNT (1 << TLSF_SL_LOG2)
+#define TLSF_FL_SHIFT (TLSF_SL_LOG2 + 3)  // log2(TLSF_SL_COUNT * ALIGNMENT)
+#define TLSF_SMALL_MAX (1 << TLSF_FL_SHIFT)
+#define TLSF_FL_COUNT 32
+
+// With MM_INDEX_SEGLIST, free blocks of at least TREE_MIN_SIZE bytes are not
+// kept on a list but in a red-black tree ordered by (size, address), so that
+// large requests get a true best fit in O(log n). The tree links live in the
+// free block's payload, like flink/blink:
+//     payload[0] is the left child, payload[1] the right child,
+//     payload[2] the parent and payload[3] is 1 if the node is red
+#define TREE_MIN_SIZE 1024
+
+// With MM_FIT_GOOD, a search of a segregated list looks at no more than
+// GOOD_FIT_PROBES blocks and takes the smallest one that fits
+#define GOOD_FIT_PROBES 8
+
+// A free block index. Each arena in mm.c has its own; all functions below
+// that look blocks up, or add or remove them, take the index to work on.
+typedef struct flist {
+  block_t *flist_heads[NUM_SIZE_CLASSES];  // head of each class's list
+  unsigned flist_bitmap;  // bit i is set iff flist_heads[i] != NULL
+  block_t *tlsf_heads[TLSF_FL_COUNT][TLSF_SL_COUNT];
+  unsigned tlsf_fl_bitmap;  // bit i is set iff tlsf_sl_bitmap[i] != 0
+  unsigned tlsf_sl_bitmap[TLSF_FL_COUNT];  // one bit per non-empty list
+  block_t *tree_root;
+  mm_index_t flist_index;  // which of the two indexes is in use
+  mm_fit_t fit;            // how the segregated lists are searched
+  mm_order_t order;        // how blocks are inserted into them
+  block_t *rovers[NUM_SIZE_CLASSES];  // MM_FIT_NEXT: where to start searching
+  int probe_budget;     // most blocks a search of one list looks at
+  unsigned search_max;  // most blocks any search of a list has looked at
+  size_t free_bytes;    // total size of the blocks in the index
+} flist_t;
+
+// The low bits of a tag hold flags rather than size (sizes are multiples of
+// ALIGNMENT):
+//     bit 0 is set if the block is allocated
+//     bit 1 is set if the previous block is allocated (MM_FOOTERLESS only)
+#define TAG_ALLOC 1
+#define TAG_PREV_ALLOC 2
+#define TAG_FLAGS (ALIGNMENT - 1)
 
 // returns a pointer to the block's end tag (You probably won't need to use this
 // directly)
-static inline size_t *block_end_tag(block_t *b) {
-  assert(b->size >= (WORD_SIZE * 2));
-  return &b->payload[(b->size / WORD_SIZE) - 2];
+// NOTE: with MM_FOOTERLESS only free blocks have an end tag
+static inline tag_t *block_end_tag(block_t *b) {
+  assert(b->size >= (TAG_SIZE * 2));
+  return &b->payload[((b->size & ~TAG_FLAGS) / TAG_SIZE) - 2];
 }
 
 // returns 1 if block is allocated, 0 otherwise
 // In other words, returns 1 if the right-most bit in b->size is set, 0
 // otherwise
-static inline int block_allocated(block_t *b) { return b->size & 1; }
+static inline int block_allocated(block_t *b) { return b->size & TAG_ALLOC; }
 
 // same as the above, but checks the end tag of the block
-// NOTE: since b->size is divided by WORD_SIZE, the 3 right-most bits are
-// truncated (including the 'is-allocated' bit)
 static inline int block_end_allocated(block_t *b) {
-  return *block_end_tag(b) & 1;
+  return *block_end_tag(b) & TAG_ALLOC;
 }
 
 // returns the size of the entire block
-// NOTE: -2 is 111...1110 in binary, so the '& -2' removes the 'is-allocated'
-// bit from the size
-static inline size_t block_size(block_t *b) { return b->size & -2; }
+// NOTE: ~TAG_FLAGS is 111...1000 in binary, so the '& ~TAG_FLAGS' removes the
+// flag bits from the size
+static inline size_t block_size(block_t *b) { return b->size & ~TAG_FLAGS; }
 
 // same as the above, but uses the end tag of the block
 static inline size_t block_end_size(block_t *b) {
-  return *block_end_tag(b) & -2;
+  return *block_end_tag(b) & ~TAG_FLAGS;
 }
 
 // Sets the entire size of the block at both the beginning and the end tags.
-// Preserves the alloc bit (if b is marked allocated or free, it will remain
+// Preserves the flag bits (if b is marked allocated or free, it will remain
 // so).
 // NOTE: size must be a multiple of ALIGNMENT, which means that in binary, its
 // right-most 3 bits must be 0.
@@ -43,45 +95,94 @@ static inline size_t block_end_size(block_t *b) {
 // ALIGNMENT - 1, which is 00..00111 in binary if ALIGNMENT is 8.
 static inline void block_set_size(block_t *b, size_t size) {
   assert((size & (ALIGNMENT - 1)) == 0);
-  // alloc bit is always 0 to start with if the above assert passes
-  size |= block_allocated(b);
+  // flag bits are always 0 to start with if the above assert passes
+  size |= b->size & (TAG_ALLOC | TAG_PREV_ALLOC);
   b->size = size;
+#ifdef MM_FOOTERLESS
+  // an allocated block's last word belongs to its payload
+  if (block_allocated(b)) {
+    return;
+  }
+#endif
   *block_end_tag(b) = size;
 }
 
 // Sets the allocated flags of the block, at both the beginning and the end
 // tags.
-// NOTE: -2 is 111...1110 in binary
+// NOTE: with MM_FOOTERLESS the end tag is (re)written only when the block
+// becomes free; the next block's prev-allocated bit is the caller's job
 static inline void block_set_allocated(block_t *b, int allocated) {
   assert((allocated == 0) || (allocated == 1));
+#ifdef MM_FOOTERLESS
+  if (allocated) {
+    b->size |= TAG_ALLOC;
+  } else {
+    b->size &= ~(tag_t)TAG_ALLOC;
+    *block_end_tag(b) = b->size;
+  }
+#else
   if (allocated) {
-    b->size |= 1;
-    *block_end_tag(b) |= 1;
+    b->size |= TAG_ALLOC;
+    *block_end_tag(b) |= TAG_ALLOC;
   } else {
-    b->size &= -2;
-    *block_end_tag(b) &= -2;
+    b->size &= ~(tag_t)TAG_ALLOC;
+    *block_end_tag(b) &= ~(tag_t)TAG_ALLOC;
   }
+#endif
 }
 
 // Sets the entire size of the block and sets the allocated flags of the block,
 // at both the beginning and the end
 static inline void block_set_size_and_allocated(block_t *b, size_t size,
                                                 int allocated) {
+#ifdef MM_FOOTERLESS
+  // the header may be stale here, so don't let a stale alloc bit decide
+  // whether an end tag gets written
+  assert((size & (ALIGNMENT - 1)) == 0);
+  b->size = size | (b->size & TAG_PREV_ALLOC) | (size_t)allocated;
+  if (!allocated) {
+    *block_end_tag(b) = b->size;
+  }
+#else
   block_set_size(b, size);
   block_set_allocated(b, allocated);
+#endif
+}
+
+#ifdef MM_FOOTERLESS
+// records in b's header whether the block before b is allocated
+static inline void block_set_prev_allocated(block_t *b, int prev_allocated) {
+  if (prev_allocated) {
+    b->size |= TAG_PREV_ALLOC;
+  } else {
+    b->size &= ~(tag_t)TAG_PREV_ALLOC;
+  }
 }
 
 // returns 1 if the previous block is allocated, 0 otherwise
 static inline int block_prev_allocated(block_t *b) {
-  size_t *tag = ((size_t *)b) - 1;
-  return *tag & 1;
+  return (b->size & TAG_PREV_ALLOC) != 0;
+}
+#else
+// every block has an end tag, so there is no prev-allocated bit to maintain
+static inline void block_set_prev_allocated(block_t *b, int prev_allocated) {
+  (void)b;
+  (void)prev_allocated;
 }
 
+// returns 1 if the previous block is allocated, 0 otherwise
+static inline int block_prev_allocated(block_t *b) {
+  tag_t *tag = ((tag_t *)b) - 1;
+  return *tag & TAG_ALLOC;
+}
+#endif
+
 // returns the size of the previous block
-// NOTE: -2 is 111...1110 in binary
+// NOTE: reads the previous block's end tag, so (with MM_FOOTERLESS) it is
+// only valid if the previous block is free
 static inline size_t block_prev_size(block_t *b) {
-  size_t *tag = ((size_t *)b) - 1;
-  return *tag & -2;
+  tag_t *tag = ((tag_t *)b) - 1;
+  return *tag & ~TAG_FLAGS;
 }
 
 // returns a pointer to the previous block
@@ -106,22 +207,38 @@ static inline size_t block_next_size(block_t *b) {
 
 // given a pointer to the payload, returns a pointer to the block
 static inline block_t *payload_to_block(void *payload) {
-  return (block_t *)((size_t *)payload - 1);
+  return (block_t *)((tag_t *)payload - 1);
 }
 
+#ifdef MM_COMPACT
+// Links to other blocks are stored as offsets from the start of the heap.
+// No block starts at offset 0, so 0 encodes NULL.
+static inline tag_t block_to_link(block_t *b) {
+  return b ? (tag_t)((char *)b - (char *)mem_heap_lo()) : 0;
+}
+
+static inline block_t *link_to_block(tag_t link) {
+  return link ? (block_t *)((char *)mem_heap_lo() + link) : NULL;
+}
+#else
+static inline tag_t block_to_link(block_t *b) { return (tag_t)b; }
+
+static inline block_t *link_to_block(tag_t link) { return (block_t *)link; }
+#endif
+
 // given the input block 'b', returns b's flink, which points to the
 // next block in the free list
 // NOTE: if 'b' is free, b->payload[0] contains b's flink
 static inline block_t *block_flink(block_t *b) {
   assert(!block_allocated(b));
-  return (block_t *)b->payload[0];
+  return link_to_block(b->payload[0]);
 }
 
 // given the inputs 'b' and 'new_flink', sets b's flink to now point
 // to new_flink, which should be the next block in the free list
 static inline void block_set_flink(block_t *b, block_t *new_flink) {
   assert(!block_allocated(b) && !block_allocated(new_flink));
-  b->payload[0] = (size_t)new_flink;
+  b->payload[0] = block_to_link(new_flink);
 }
 
 // given the input block 'b', returns b's blink, which points to the
@@ -129,49 +246,566 @@ static inline void block_set_flink(block_t *b, block_t *new_flink) {
 // NOTE: if 'b' is free, b->payload[1] contains b's blink
 static inline block_t *block_blink(block_t *b) {
   assert(!block_allocated(b));
-  return (block_t *)b->payload[1];
+  return link_to_block(b->payload[1]);
 }
 
 // given the inputs 'b' and 'new_blink', sets b's blink to now point
 // to new_blink, which should be the previous block in the free list
 static inline void block_set_blink(block_t *b, block_t *new_blink) {
   assert(!block_allocated(b) && !block_allocated(new_blink));
-  b->payload[1] = (size_t)new_blink;
+  b->payload[1] = block_to_link(new_blink);
 }
 
-// pull a block from the (circularly doubly linked) free list
-static inline void pull_free_block(block_t *fb) {
-  assert(!block_allocated(fb));
-  if (flist_first == fb) {
-    if ((flist_first = block_flink(fb)) == fb) {
-      flist_first = NULL;
-      return;
+// returns floor(log2(x)) for x > 0
+static inline int log2_floor(size_t x) {
+  return (int)(8 * sizeof(unsigned long)) - 1 - __builtin_clzl(x);
+}
+
+// returns the size class that a free block of 'size' bytes belongs to
+static inline int size_class(size_t size) {
+  if (size <= SMALL_CLASS_MAX) {
+    return (int)((size - MINBLOCKSIZE) / ALIGNMENT);
+  }
+  int c = NUM_SMALL_CLASSES + log2_floor(size) - log2_floor(SMALL_CLASS_MAX);
+  return (c < NUM_SIZE_CLASSES) ? c : NUM_SIZE_CLASSES - 1;
+}
+
+// returns the first non-empty size class >= c, or -1 if there is none
+static inline int flist_next_class(flist_t *idx, int c) {
+  if (c >= NUM_SIZE_CLASSES) {
+    return -1;
+  }
+  unsigned mask = idx->flist_bitmap & (~0u << c);
+  return mask ? __builtin_ctz(mask) : -1;
+}
+
+// inserts fb at the head of the circular, doubly linked list '*head'
+// returns 1 if the list was empty before, 0 otherwise
+static inline int list_insert(block_t **head, block_t *fb) {
+  block_t *first = *head;
+  *head = fb;
+  if (first != NULL) {
+    block_t *last = block_blink(first);
+    // put 'fb' in between 'first' and 'last'
+    block_set_flink(fb, first);
+    block_set_blink(fb, last);
+    // update 'last' and 'first' so they point to 'fb'
+    block_set_flink(last, fb);
+    block_set_blink(first, fb);
+    return 0;
+  }
+  // The list is empty, so when we insert fb, it will be the
+  // only element in the list.
+  // Thus it needs to point to itself from both flink and blink
+  // (since the list is circular)
+  block_set_flink(fb, fb);
+  block_set_blink(fb, fb);
+  return 1;
+}
+
+// inserts fb into the circular, doubly linked list '*head', which is kept
+// sorted by address from the head
+// returns 1 if the list was empty before, 0 otherwise
+static inline int list_insert_ordered(block_t **head, block_t *fb) {
+  block_t *first = *head;
+  if (first == NULL || fb < first) {
+    return list_insert(head, fb);
+  }
+  block_t *prev = first;
+  while (block_flink(prev) != first && block_flink(prev) < fb) {
+    prev = block_flink(prev);
+  }
+  block_t *next = block_flink(prev);
+  block_set_flink(fb, next);
+  block_set_blink(fb, prev);
+  block_set_flink(prev, fb);
+  block_set_blink(next, fb);
+  return 0;
+}
+
+// pulls fb from the circular, doubly linked list '*head'
+// returns 1 if the list is now empty, 0 otherwise
+static inline int list_pull(block_t **head, block_t *fb) {
+  if (*head == fb) {
+    if ((*head = block_flink(fb)) == fb) {
+      *head = NULL;
+      return 1;
     }
   }
   block_set_flink(block_blink(fb), block_flink(fb));
   block_set_blink(block_flink(fb), block_blink(fb));
+  return 0;
 }
 
-// insert block into the (circularly doubly linked) free list
-static inline void insert_free_block(block_t *fb) {
-  assert(!block_allocated(fb));
-  if (flist_first != NULL) {
-    block_t *last = block_blink(flist_first);
-    // put 'fb' in between 'flist_first' and 'last'
-    block_set_flink(fb, flist_first);
-    block_set_blink(fb, last);
-    // update 'last' and 'flist_first' so they point to 'fb'
-    block_set_flink(last, fb);
-    block_set_blink(flist_first, fb);
+static inline block_t *tree_left(block_t *b) {
+  return link_to_block(b->payload[0]);
+}
+static inline block_t *tree_right(block_t *b) {
+  return link_to_block(b->payload[1]);
+}
+static inline block_t *tree_parent(block_t *b) {
+  return link_to_block(b->payload[2]);
+}
+static inline void tree_set_left(block_t *b, block_t *l) {
+  b->payload[0] = block_to_link(l);
+}
+static inline void tree_set_right(block_t *b, block_t *r) {
+  b->payload[1] = block_to_link(r);
+}
+static inline void tree_set_parent(block_t *b, block_t *p) {
+  b->payload[2] = block_to_link(p);
+}
+
+// returns 1 if b is a red node; empty (NULL) subtrees are black
+static inline int tree_red(block_t *b) { return b != NULL && b->payload[3]; }
+static inline void tree_set_red(block_t *b, int red) { b->payload[3] = red; }
+
+// returns 1 if a orders before b: by size, then by address
+static inline int tree_less(block_t *a, block_t *b) {
+  size_t sa = block_size(a), sb = block_size(b);
+  return (sa < sb) || (sa == sb && a < b);
+}
+
+// makes 'new' take the place of 'old' as a child of 'parent'
+static inline void tree_replace_child(flist_t *idx, block_t *parent,
+                                      block_t *old, block_t *new) {
+  if (parent == NULL) {
+    idx->tree_root = new;
+  } else if (tree_left(parent) == old) {
+    tree_set_left(parent, new);
   } else {
-    // The free list is empty, so when we insert fb, it will be the
-    // only element in the list.
-    // Thus it needs to point to itself from both flink and blink
-    // (since the list is circular)
-    block_set_flink(fb, fb);
-    block_set_blink(fb, fb);
-  }
-  flist_first = fb;
+    tree_set_right(parent, new);
+  }
+}
+
+static inline void tree_rotate_left(flist_t *idx, block_t *x) {
+  block_t *y = tree_right(x);
+  tree_set_right(x, tree_left(y));
+  if (tree_left(y) != NULL) {
+    tree_set_parent(tree_left(y), x);
+  }
+  tree_set_parent(y, tree_parent(x));
+  tree_replace_child(idx, tree_parent(x), x, y);
+  tree_set_left(y, x);
+  tree_set_parent(x, y);
+}
+
+static inline void tree_rotate_right(flist_t *idx, block_t *x) {
+  block_t *y = tree_left(x);
+  tree_set_left(x, tree_right(y));
+  if (tree_right(y) != NULL) {
+    tree_set_parent(tree_right(y), x);
+  }
+  tree_set_parent(y, tree_parent(x));
+  tree_replace_child(idx, tree_parent(x), x, y);
+  tree_set_right(y, x);
+  tree_set_parent(x, y);
+}
+
+// inserts free block z into the tree and restores the red-black properties
+static inline void tree_insert(flist_t *idx, block_t *z) {
+  block_t *parent = NULL;
+  block_t *cur = idx->tree_root;
+  while (cur != NULL) {
+    parent = cur;
+    cur = tree_less(z, cur) ? tree_left(cur) : tree_right(cur);
+  }
+  tree_set_left(z, NULL);
+  tree_set_right(z, NULL);
+  tree_set_parent(z, parent);
+  tree_set_red(z, 1);
+  if (parent == NULL) {
+    idx->tree_root = z;
+  } else if (tree_less(z, parent)) {
+    tree_set_left(parent, z);
+  } else {
+    tree_set_right(parent, z);
+  }
+
+  block_t *p;
+  while ((p = tree_parent(z)) != NULL && tree_red(p)) {
+    // p is red, so it is not the root and z has a grandparent
+    block_t *g = tree_parent(p);
+    if (p == tree_left(g)) {
+      block_t *u = tree_right(g);
+      if (tree_red(u)) {
+        tree_set_red(p, 0);
+        tree_set_red(u, 0);
+        tree_set_red(g, 1);
+        z = g;
+        continue;
+      }
+      if (z == tree_right(p)) {
+        tree_rotate_left(idx, p);
+        z = p;
+        p = tree_parent(z);
+      }
+      tree_set_red(p, 0);
+      tree_set_red(g, 1);
+      tree_rotate_right(idx, g);
+    } else {
+      block_t *u = tree_left(g);
+      if (tree_red(u)) {
+        tree_set_red(p, 0);
+        tree_set_red(u, 0);
+        tree_set_red(g, 1);
+        z = g;
+        continue;
+      }
+      if (z == tree_left(p)) {
+        tree_rotate_right(idx, p);
+        z = p;
+        p = tree_parent(z);
+      }
+      tree_set_red(p, 0);
+      tree_set_red(g, 1);
+      tree_rotate_left(idx, g);
+    }
+  }
+  tree_set_red(idx->tree_root, 0);
+}
+
+// replaces the subtree rooted at u with the one rooted at v
+static inline void tree_transplant(flist_t *idx, block_t *u, block_t *v) {
+  tree_replace_child(idx, tree_parent(u), u, v);
+  if (v != NULL) {
+    tree_set_parent(v, tree_parent(u));
+  }
+}
+
+// removes free block z from the tree and restores the red-black properties
+static inline void tree_delete(flist_t *idx, block_t *z) {
+  block_t *x;         // the node that moves into the removed node's place
+  block_t *x_parent;  // x's parent (x itself may be NULL)
+  int removed_red = tree_red(z);
+
+  if (tree_left(z) == NULL) {
+    x = tree_right(z);
+    x_parent = tree_parent(z);
+    tree_transplant(idx, z, x);
+  } else if (tree_right(z) == NULL) {
+    x = tree_left(z);
+    x_parent = tree_parent(z);
+    tree_transplant(idx, z, x);
+  } else {
+    // z has two children: its successor y takes its place
+    block_t *y = tree_right(z);
+    while (tree_left(y) != NULL) {
+      y = tree_left(y);
+    }
+    removed_red = tree_red(y);
+    x = tree_right(y);
+    if (tree_parent(y) == z) {
+      x_parent = y;
+    } else {
+      x_parent = tree_parent(y);
+      tree_transplant(idx, y, x);
+      tree_set_right(y, tree_right(z));
+      tree_set_parent(tree_right(y), y);
+    }
+    tree_transplant(idx, z, y);
+    tree_set_left(y, tree_left(z));
+    tree_set_parent(tree_left(y), y);
+    tree_set_red(y, tree_red(z));
+  }
+  if (removed_red) {
+    return;
+  }
+
+  // a black node was removed, so x carries an extra black
+  while (x != idx->tree_root && !tree_red(x)) {
+    if (x == tree_left(x_parent)) {
+      block_t *w = tree_right(x_parent);
+      if (tree_red(w)) {
+        tree_set_red(w, 0);
+        tree_set_red(x_parent, 1);
+        tree_rotate_left(idx, x_parent);
+        w = tree_right(x_parent);
+      }
+      if (!tree_red(tree_left(w)) && !tree_red(tree_right(w))) {
+        tree_set_red(w, 1);
+        x = x_parent;
+        x_parent = tree_parent(x);
+      } else {
+        if (!tree_red(tree_right(w))) {
+          tree_set_red(tree_left(w), 0);
+          tree_set_red(w, 1);
+          tree_rotate_right(idx, w);
+          w = tree_right(x_parent);
+        }
+        tree_set_red(w, tree_red(x_parent));
+        tree_set_red(x_parent, 0);
+        tree_set_red(tree_right(w), 0);
+        tree_rotate_left(idx, x_parent);
+        x = idx->tree_root;
+      }
+    } else {
+      block_t *w = tree_left(x_parent);
+      if (tree_red(w)) {
+        tree_set_red(w, 0);
+        tree_set_red(x_parent, 1);
+        tree_rotate_right(idx, x_parent);
+        w = tree_left(x_parent);
+      }
+      if (!tree_red(tree_left(w)) && !tree_red(tree_right(w))) {
+        tree_set_red(w, 1);
+        x = x_parent;
+        x_parent = tree_parent(x);
+      } else {
+        if (!tree_red(tree_left(w))) {
+          tree_set_red(tree_right(w), 0);
+          tree_set_red(w, 1);
+          tree_rotate_left(idx, w);
+          w = tree_left(x_parent);
+        }
+        tree_set_red(w, tree_red(x_parent));
+        tree_set_red(x_parent, 0);
+        tree_set_red(tree_left(w), 0);
+        tree_rotate_right(idx, x_parent);
+        x = idx->tree_root;
+      }
+    }
+  }
+  if (x != NULL) {
+    tree_set_red(x, 0);
+  }
+}
+
+// returns the smallest free block in the tree that is at least 'size'
+// bytes (the lowest-addressed one among equals), or NULL if there is none
+static inline block_t *tree_best_fit(flist_t *idx, size_t size) {
+  block_t *best = NULL;
+  block_t *cur = idx->tree_root;
+  while (cur != NULL) {
+    if (block_size(cur) >= size) {
+      best = cur;
+      cur = tree_left(cur);
+    } else {
+      cur = tree_right(cur);
+    }
+  }
+  return best;
+}
+
+// computes the TLSF first and second level list that a free block of 'size'
+// bytes belongs to
+static inline void tlsf_mapping(size_t size, int *fl, int *sl) {
+  if (size < TLSF_SMALL_MAX) {
+    *fl = 0;
+    *sl = (int)(size / ALIGNMENT);
+    return;
+  }
+  int log2 = log2_floor(size);
+  *sl = (int)(size >> (log2 - TLSF_SL_LOG2)) ^ TLSF_SL_COUNT;
+  *fl = log2 - TLSF_FL_SHIFT + 1;
+}
+
+// returns the first block of at least 'size' bytes in the request's own
+// TLSF list, which also holds smaller blocks, looking at no more than
+// idx->probe_budget of them; or NULL if there is none
+static inline block_t *tlsf_own_fit(flist_t *idx, size_t size) {
+  int fl, sl;
+  tlsf_mapping(size, &fl, &sl);
+  if (fl >= TLSF_FL_COUNT || idx->tlsf_heads[fl][sl] == NULL) {
+    return NULL;
+  }
+  block_t *first = idx->tlsf_heads[fl][sl];
+  block_t *fb = first;
+  int probes = 0;
+  do {
+    probes++;
+    if (block_size(fb) >= size) {
+      break;
+    }
+    fb = block_flink(fb);
+  } while (fb != first && probes < idx->probe_budget);
+  if ((unsigned)probes > idx->search_max) {
+    idx->search_max = probes;
+  }
+  return (block_size(fb) >= size) ? fb : NULL;
+}
+
+// returns the head of a TLSF list whose blocks are all at least 'size'
+// bytes. Found with two find-first-set operations on the bitmaps, so the
+// cost does not depend on the number of free blocks. Failing that, the
+// request's own list is searched first fit before the heap has to grow.
+// returns NULL if neither has a block.
+static inline block_t *tlsf_find(flist_t *idx, size_t size) {
+  size_t want = size;
+  if (size >= TLSF_SMALL_MAX) {
+    // round up to the next second-level boundary so that every block in the
+    // chosen list is big enough
+    size += ((size_t)1 << (log2_floor(size) - TLSF_SL_LOG2)) - 1;
+  }
+  int fl, sl;
+  tlsf_mapping(size, &fl, &sl);
+  if (fl >= TLSF_FL_COUNT) {
+    return tlsf_own_fit(idx, want);
+  }
+  unsigned sl_map = idx->tlsf_sl_bitmap[fl] & (~0u << sl);
+  if (sl_map == 0) {
+    unsigned fl_map =
+        (fl + 1 < TLSF_FL_COUNT) ? idx->tlsf_fl_bitmap & (~0u << (fl + 1)) : 0;
+    if (fl_map == 0) {
+      return (want >= TLSF_SMALL_MAX) ? tlsf_own_fit(idx, want) : NULL;
+    }
+    fl = __builtin_ctz(fl_map);
+    sl_map = idx->tlsf_sl_bitmap[fl];
+  }
+  return idx->tlsf_heads[fl][__builtin_ctz(sl_map)];
+}
+
+// returns a block of at least 'size' bytes from the list of class c, picked
+// by the index's fit policy, or NULL if there is none:
+//     MM_FIT_FIRST: the first one from the head
+//     MM_FIT_NEXT: the first one from where the last search of c stopped
+//     MM_FIT_BEST: the smallest one
+//     MM_FIT_GOOD: the smallest of the first GOOD_FIT_PROBES blocks
+// Whatever the policy, the search gives up after idx->probe_budget blocks
+// and takes the best block seen so far, if any.
+static inline block_t *list_fit(flist_t *idx, int c, size_t size) {
+  block_t *first = idx->flist_heads[c];
+  if (first == NULL) {
+    return NULL;
+  }
+  if (idx->fit == MM_FIT_NEXT && idx->rovers[c] != NULL) {
+    first = idx->rovers[c];
+  }
+  int limit = idx->probe_budget;
+  if (idx->fit == MM_FIT_GOOD && limit > GOOD_FIT_PROBES) {
+    limit = GOOD_FIT_PROBES;
+  }
+  block_t *best = NULL;
+  int probes = 0;
+  block_t *fb = first;
+  do {
+    probes++;
+    if (block_size(fb) >= size) {
+      if (best == NULL || block_size(fb) < block_size(best)) {
+        best = fb;
+      }
+      if (idx->fit == MM_FIT_FIRST || idx->fit == MM_FIT_NEXT ||
+          block_size(fb) == size) {
+        break;
+      }
+    }
+    fb = block_flink(fb);
+  } while (fb != first && probes < limit);
+  if ((unsigned)probes > idx->search_max) {
+    idx->search_max = probes;
+  }
+  if (idx->fit == MM_FIT_NEXT && best != NULL) {
+    idx->rovers[c] = best;
+  }
+  return best;
+}
+
+// returns a block that is at least 'size' bytes from the segregated lists,
+// or NULL if there is none. The request's own size class may hold blocks
+// that are too small, so it is searched by the fit policy; failing that,
+// any block of the next non-empty class fits. With first fit and LIFO
+// lists, that is the class's oldest block (the list tail), which gives
+// better utilization than the most recently freed one. Large requests, and
+// small ones that no list can satisfy, take the best fit from the tree.
+static inline block_t *seglist_find(flist_t *idx, size_t size) {
+  if (size >= TREE_MIN_SIZE) {
+    return tree_best_fit(idx, size);
+  }
+  int c = size_class(size);
+  block_t *fb = list_fit(idx, c, size);
+  if (fb != NULL) {
+    return fb;
+  }
+
+  c = flist_next_class(idx, c + 1);
+  if (c < 0) {
+    return tree_best_fit(idx, size);
+  }
+  if (idx->fit == MM_FIT_FIRST && idx->order == MM_ORDER_LIFO) {
+    return block_blink(idx->flist_heads[c]);
+  }
+  return list_fit(idx, c, size);
+}
+
+// empties the free block index and switches it to 'index', searching and
+// ordering its segregated lists by 'fit' and 'order'
+static inline void flist_reset(flist_t *idx, mm_index_t index, mm_fit_t fit,
+                               mm_order_t order) {
+  memset(idx->flist_heads, 0, sizeof(idx->flist_heads));
+  memset(idx->rovers, 0, sizeof(idx->rovers));
+  idx->fit = fit;
+  idx->order = order;
+  idx->search_max = 0;
+  idx->free_bytes = 0;
+  idx->flist_bitmap = 0;
+  idx->tree_root = NULL;
+  memset(idx->tlsf_heads, 0, sizeof(idx->tlsf_heads));
+  memset(idx->tlsf_sl_bitmap, 0, sizeof(idx->tlsf_sl_bitmap));
+  idx->tlsf_fl_bitmap = 0;
+  idx->flist_index = index;
+}
+
+// returns a free block of at least 'size' bytes, or NULL if there is none
+static inline block_t *flist_find(flist_t *idx, size_t size) {
+  if (idx->flist_index == MM_INDEX_TLSF) {
+    return tlsf_find(idx, size);
+  }
+  return seglist_find(idx, size);
+}
+
+// pull a block from the free block index
+// NOTE: must be called before the block's size is changed
+static inline void pull_free_block(flist_t *idx, block_t *fb) {
+  assert(!block_allocated(fb));
+  idx->free_bytes -= block_size(fb);
+  if (idx->flist_index == MM_INDEX_TLSF) {
+    int fl, sl;
+    tlsf_mapping(block_size(fb), &fl, &sl);
+    if (list_pull(&idx->tlsf_heads[fl][sl], fb)) {
+      idx->tlsf_sl_bitmap[fl] &= ~(1u << sl);
+      if (idx->tlsf_sl_bitmap[fl] == 0) {
+        idx->tlsf_fl_bitmap &= ~(1u << fl);
+      }
+    }
+    return;
+  }
+  if (block_size(fb) >= TREE_MIN_SIZE) {
+    tree_delete(idx, fb);
+    return;
+  }
+  int c = size_class(block_size(fb));
+  if (idx->rovers[c] == fb) {
+    idx->rovers[c] = (block_flink(fb) != fb) ? block_flink(fb) : NULL;
+  }
+  if (list_pull(&idx->flist_heads[c], fb)) {
+    idx->flist_bitmap &= ~(1u << c);
+  }
+}
+
+// insert block into the free block index
+static inline void insert_free_block(flist_t *idx, block_t *fb) {
+  assert(!block_allocated(fb));
+  idx->free_bytes += block_size(fb);
+  if (idx->flist_index == MM_INDEX_TLSF) {
+    int fl, sl;
+    tlsf_mapping(block_size(fb), &fl, &sl);
+    if (list_insert(&idx->tlsf_heads[fl][sl], fb)) {
+      idx->tlsf_sl_bitmap[fl] |= 1u << sl;
+      idx->tlsf_fl_bitmap |= 1u << fl;
+    }
+    return;
+  }
+  if (block_size(fb) >= TREE_MIN_SIZE) {
+    tree_insert(idx, fb);
+    return;
+  }
+  int c = size_class(block_size(fb));
+  int was_empty = (idx->order == MM_ORDER_ADDRESS)
+                      ? list_insert_ordered(&idx->flist_heads[c], fb)
+                      : list_insert(&idx->flist_heads[c], fb);
+  if (was_empty) {
+    idx->flist_bitmap |= 1u << c;
+  }
 }
 
 #endif  // MMINLINE_H_
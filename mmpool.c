@@ -0,0 +1,117 @@
+#include <stdint.h>
+
+#include "./mm.h"
+#include "./mmpool.h"
+
+/*
+ * A pool carves objects out of chunks that it gets from mm_malloc. A chunk
+ * is POOL_CHUNK bytes, which keeps it in the heap below mm's mmap threshold,
+ * or large enough for POOL_MIN_OBJECTS objects if they are bigger. Objects
+ * of the newest chunk are handed out in address order with a bump pointer,
+ * so a chunk is never walked to build a free list; freed objects go onto
+ * the pool's free list and are reused first. Chunks are only given back by
+ * mm_pool_destroy.
+ */
+#define POOL_CHUNK (64 * 1024)
+#define POOL_MIN_OBJECTS 16
+
+// header at the start of every chunk; the objects follow it
+typedef struct pool_chunk {
+    struct pool_chunk *next;  // the pool's other chunks
+} pool_chunk_t;
+
+#define CHUNK_HEADER \
+    ((sizeof(pool_chunk_t) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1))
+
+struct mm_pool {
+    size_t size;          // object size, a multiple of ALIGNMENT
+    size_t chunk_size;    // bytes asked of mm_malloc for each chunk
+    void *free;           // freed objects, linked through their first word
+    char *bump;           // next object of the newest chunk never handed out
+    char *end;            // end of the newest chunk
+    pool_chunk_t *chunks; // every chunk, newest first
+};
+
+/*
+mm_pool_create: makes an empty pool of objects of size bytes; objects are
+at least a pointer wide, to hold the free list link.
+returns the pool, or NULL if mm_malloc fails.
+*/
+mm_pool_t *mm_pool_create(size_t size) {
+    mm_pool_t *pool = mm_malloc(sizeof(mm_pool_t));
+    if (pool == NULL) {
+        return NULL;
+    }
+    if (size < sizeof(void *)) {
+        size = sizeof(void *);
+    }
+    pool->size = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+    pool->chunk_size = CHUNK_HEADER + POOL_MIN_OBJECTS * pool->size;
+    if (pool->chunk_size < POOL_CHUNK) {
+        pool->chunk_size = POOL_CHUNK;
+    }
+    pool->free = NULL;
+    pool->bump = NULL;
+    pool->end = NULL;
+    pool->chunks = NULL;
+    return pool;
+}
+
+/*
+pool_grow: gets a new chunk from mm_malloc and makes it the one the bump
+pointer hands objects out of. What is left of the previous chunk is lost
+until the pool is destroyed, which is less than one object.
+returns 0, or -1 if mm_malloc fails.
+*/
+static int pool_grow(mm_pool_t *pool) {
+    pool_chunk_t *chunk = mm_malloc(pool->chunk_size);
+    if (chunk == NULL) {
+        return -1;
+    }
+    chunk->next = pool->chunks;
+    pool->chunks = chunk;
+    pool->bump = (char *)chunk + CHUNK_HEADER;
+    pool->end = (char *)chunk + pool->chunk_size;
+    return 0;
+}
+
+/*
+mm_pool_alloc: takes the most recently freed object, or else the next one
+of the newest chunk, getting a new chunk if it is used up.
+returns the object, or NULL if mm_malloc fails.
+*/
+void *mm_pool_alloc(mm_pool_t *pool) {
+    void *obj = pool->free;
+    if (obj != NULL) {
+        pool->free = *(void **)obj;
+        return obj;
+    }
+    if ((size_t)(pool->end - pool->bump) < pool->size && pool_grow(pool) < 0) {
+        return NULL;
+    }
+    obj = pool->bump;
+    pool->bump += pool->size;
+    return obj;
+}
+
+/*
+mm_pool_free: pushes obj onto the pool's free list.
+*/
+void mm_pool_free(mm_pool_t *pool, void *obj) {
+    *(void **)obj = pool->free;
+    pool->free = obj;
+}
+
+/*
+mm_pool_destroy: gives every chunk back to mm_free, then the pool itself;
+objects still allocated from the pool go with them.
+*/
+void mm_pool_destroy(mm_pool_t *pool) {
+    pool_chunk_t *chunk = pool->chunks;
+    while (chunk != NULL) {
+        pool_chunk_t *next = chunk->next;
+        mm_free(chunk);
+        chunk = next;
+    }
+    mm_free(pool);
+}
@@ -0,0 +1,22 @@
+#ifndef MMPOOL_H_
+#define MMPOOL_H_
+
+#include <stddef.h>
+
+// Fixed-size object pools on top of mm_malloc. A pool takes large chunks
+// from mm_malloc and cuts them into objects of a single size, with no
+// header per object: a freed object is linked into the pool's free list
+// through its first word, and allocation pops it back off. A pool is not
+// thread-safe; give each thread its own, or lock around it.
+typedef struct mm_pool mm_pool_t;
+
+// returns a pool of objects of size bytes, or NULL if mm_malloc fails
+mm_pool_t *mm_pool_create(size_t size);
+// returns an object from the pool, or NULL if mm_malloc fails
+void *mm_pool_alloc(mm_pool_t *pool);
+// returns obj, which came from mm_pool_alloc on the same pool, to the pool
+void mm_pool_free(mm_pool_t *pool, void *obj);
+// frees every chunk of the pool, and with them all of its objects
+void mm_pool_destroy(mm_pool_t *pool);
+
+#endif  // MMPOOL_H_
@@ -0,0 +1,132 @@
+#include <stdint.h>
+
+#include "./mm.h"
+#include "./mmzone.h"
+
+/*
+ * A zone keeps a list of chunks from mm_malloc, and allocates from the
+ * current one by moving a bump pointer. When the current chunk is full, the
+ * zone moves on to the next chunk in the list if the request fits in it, or
+ * else gets a new chunk from mm_malloc and links it in after the current
+ * one. Chunks are ZONE_CHUNK bytes, below mm's mmap threshold, unless a
+ * request needs more. A reset makes the first chunk current again, so the
+ * chunks are reused rather than freed, and a zone holds on to as much
+ * memory as it used at its busiest.
+ */
+#define ZONE_CHUNK (64 * 1024)
+
+// header at the start of every chunk; the zone's memory follows it
+typedef struct zone_chunk {
+    struct zone_chunk *next;
+    size_t size;  // bytes of the chunk, header included
+} zone_chunk_t;
+
+#define ZONE_HEADER \
+    ((sizeof(zone_chunk_t) + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1))
+
+struct mm_zone {
+    zone_chunk_t *first;  // the chunks, in the order they are used
+    zone_chunk_t *cur;    // the chunk being allocated from
+    char *bump;           // next free byte of cur
+    char *end;            // end of cur
+};
+
+// makes chunk c the zone's current chunk, with all of its space free
+static inline void zone_use(mm_zone_t *zone, zone_chunk_t *c) {
+    zone->cur = c;
+    zone->bump = (char *)c + ZONE_HEADER;
+    zone->end = (char *)c + c->size;
+}
+
+/*
+zone_chunk_new: gets a chunk of size bytes from mm_malloc.
+returns it, or NULL if mm_malloc fails.
+*/
+static zone_chunk_t *zone_chunk_new(size_t size) {
+    zone_chunk_t *c = mm_malloc(size);
+    if (c != NULL) {
+        c->next = NULL;
+        c->size = size;
+    }
+    return c;
+}
+
+/*
+mm_zone_create: makes a zone with one chunk.
+returns the zone, or NULL if mm_malloc fails.
+*/
+mm_zone_t *mm_zone_create(void) {
+    mm_zone_t *zone = mm_malloc(sizeof(mm_zone_t));
+    if (zone == NULL) {
+        return NULL;
+    }
+    zone->first = zone_chunk_new(ZONE_CHUNK);
+    if (zone->first == NULL) {
+        mm_free(zone);
+        return NULL;
+    }
+    zone_use(zone, zone->first);
+    return zone;
+}
+
+/*
+zone_next: makes a chunk with room for size bytes the current chunk: the
+next one if it is large enough, or else a new one linked in after the
+current chunk.
+returns 0, or -1 if mm_malloc fails.
+*/
+static int zone_next(mm_zone_t *zone, size_t size) {
+    zone_chunk_t *next = zone->cur->next;
+    if (next == NULL || next->size - ZONE_HEADER < size) {
+        size_t chunk_size = ZONE_HEADER + size;
+        if (chunk_size < ZONE_CHUNK) {
+            chunk_size = ZONE_CHUNK;
+        }
+        zone_chunk_t *c = zone_chunk_new(chunk_size);
+        if (c == NULL) {
+            return -1;
+        }
+        c->next = next;
+        zone->cur->next = c;
+        next = c;
+    }
+    zone_use(zone, next);
+    return 0;
+}
+
+/*
+mm_zone_alloc: bumps the zone's pointer by size bytes, rounded up to
+ALIGNMENT, moving on to another chunk if the current one is full.
+returns the memory, or NULL if size is 0 or mm_malloc fails.
+*/
+void *mm_zone_alloc(mm_zone_t *zone, size_t size) {
+    if (size == 0) {
+        return NULL;
+    }
+    size = (size + ALIGNMENT - 1) & ~(size_t)(ALIGNMENT - 1);
+    if ((size_t)(zone->end - zone->bump) < size && zone_next(zone, size) < 0) {
+        return NULL;
+    }
+    void *p = zone->bump;
+    zone->bump += size;
+    return p;
+}
+
+/*
+mm_zone_reset: releases everything allocated from the zone by making its
+first chunk current again; no chunk is freed or walked.
+*/
+void mm_zone_reset(mm_zone_t *zone) { zone_use(zone, zone->first); }
+
+/*
+mm_zone_destroy: gives every chunk, then the zone itself, back to mm_free.
+*/
+void mm_zone_destroy(mm_zone_t *zone) {
+    zone_chunk_t *c = zone->first;
+    while (c != NULL) {
+        zone_chunk_t *next = c->next;
+        mm_free(c);
+        c = next;
+    }
+    mm_free(zone);
+}
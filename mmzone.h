@@ -0,0 +1,23 @@
+#ifndef MMZONE_H_
+#define MMZONE_H_
+
+#include <stddef.h>
+
+// Zones (region or arena allocation) on top of mm_malloc. A zone takes
+// chunks from mm_malloc and hands out memory from them with a bump pointer.
+// Objects are never freed one by one: mm_zone_reset releases everything the
+// zone handed out at once, in constant time, and keeps the chunks for the
+// next round. A zone is not thread-safe.
+typedef struct mm_zone mm_zone_t;
+
+// returns an empty zone, or NULL if mm_malloc fails
+mm_zone_t *mm_zone_create(void);
+// returns size bytes from the zone, aligned to ALIGNMENT, or NULL if size is
+// 0 or mm_malloc fails
+void *mm_zone_alloc(mm_zone_t *zone, size_t size);
+// releases everything allocated from the zone since it was made or last reset
+void mm_zone_reset(mm_zone_t *zone);
+// frees the zone and all of its chunks
+void mm_zone_destroy(mm_zone_t *zone);
+
+#endif  // MMZONE_H_
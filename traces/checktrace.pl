@@ -89,11 +89,13 @@ while ($line = <STDIN>) {
 	next;
     }
 
-    if ($cmd eq "a" and $HASH{$id} eq "a") {
+    # memalign and calloc requests allocate like an alloc request
+    if (($cmd eq "a" or $cmd eq "m" or $cmd eq "c") and
+	($HASH{$id} eq "a" or $HASH{$id} eq "m" or $HASH{$id} eq "c")) {
 	die "$0: ERROR[$linenum]: allocate with no intervening free.\n";
     }
 
-    if ($cmd eq "a" and $HASH{$id} eq "f") {
+    if (($cmd eq "a" or $cmd eq "m" or $cmd eq "c") and $HASH{$id} eq "f") {
 	die "$0: ERROR[$linenum]: reused ID $id.\n";
     }
 
@@ -146,7 +148,8 @@ foreach $item (@lines) {
 
 # print a set of free requests that will balance the trace
 foreach $key (sort keys %HASH) {
-    if ($HASH{$key} ne "a" and $HASH{$key} ne "r") {
+    if ($HASH{$key} ne "a" and $HASH{$key} ne "r" and $HASH{$key} ne "m" and
+	$HASH{$key} ne "c") {
 	die "$0: ERROR: Invalid free request in residue.\n";
     }
     print "f $key\n";
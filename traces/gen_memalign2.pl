@@ -0,0 +1,89 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+$out_filename = $argv[0];
+$out_filename = "memalign2.rep" unless $out_filename;
+$num_blocks = $argv[1];
+$num_blocks = 2400 unless $num_blocks;
+$max_blk_size = $argv[2];
+$max_blk_size = 4096 unless $max_blk_size;
+# mm_malloc maps requests of this size or more (MMAP_THRESHOLD in mm.c)
+$mmap_threshold = 131072;
+
+# Half of the requests are memaligns, to one of these boundaries
+@alignments = (16, 32, 64, 256, 4096);
+
+# Create trace
+# Make a series of malloc()s and memalign()s. A quarter of the memaligned
+# blocks are grown and shrunk by realloc()s right after they are made.
+# Every 64th block is a huge memalign, which is shrunk to a size still
+# past the mapping threshold, grown into a mapping and shrunk there.
+# The driver checks realloc'd data against the id's low byte as a char,
+# so only ids whose low byte is below 128 are reallocated.
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    $size = int(rand $max_blk_size) + 1;
+    $op = {};
+    $op->{reallocs} = [];
+    $reallocate = ($i & 0x80) == 0;
+    if ($i % 64 == 0 and $reallocate) {
+        $size = $mmap_threshold + 32768 + int(rand 65536);
+        $op->{type} = "m";
+        $op->{alignment} = 4096;
+        push @{$op->{reallocs}},
+            $mmap_threshold + int(rand($size - $mmap_threshold)),
+            2*$size, int($size / 2);
+    } elsif (rand() < 0.5) {
+        $op->{type} = "m";
+        $op->{alignment} = $alignments[int(rand @alignments)];
+        if ($reallocate and rand() < 0.25) {
+            push @{$op->{reallocs}}, int($size * 3 / 2) + 1, int($size / 2) + 1;
+        }
+    } else {
+        $op->{type} = "a";
+    }
+    $op->{seq} = $i;
+    $op->{size} = $size;
+    $total_block_size += $size;
+    $num_reallocs += @{$op->{reallocs}};
+    push @trace, $op;
+}
+# Insert free()s in proper places
+for ($i = 0;  $i < $num_blocks; $i += 1) {
+    for ($minval = $i; $minval < $num_blocks + $i; $minval += 1) {
+        if (($trace[$minval]->{type} ne "f") && ($trace[$minval]->{seq} == $i)) {
+            last;
+        }
+    }
+    $pos = int(rand($num_blocks + $i - $minval - 1) + $minval + 1);
+    $op = {};
+    $op->{type} = "f";
+    $op->{seq} = $i;
+    splice @trace, $pos, 0, $op;
+}
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+# Calculate misc parameters
+$suggested_heap_size = $total_block_size + 100;
+$num_ops = 2*$num_blocks + $num_reallocs;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$num_blocks\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+for ($i = 0;  $i < 2*$num_blocks; $i += 1) {
+    if ($trace[$i]->{type} eq "m") {
+        print OUTFILE "$trace[$i]->{type} $trace[$i]->{seq} $trace[$i]->{size} $trace[$i]->{alignment}\n";
+        foreach $size (@{$trace[$i]->{reallocs}}) {
+            print OUTFILE "r $trace[$i]->{seq} $size\n";
+        }
+    } elsif ($trace[$i]->{type} eq "a") {
+        print OUTFILE "$trace[$i]->{type} $trace[$i]->{seq} $trace[$i]->{size}\n";
+    } else {
+        print OUTFILE "$trace[$i]->{type} $trace[$i]->{seq}\n";
+    }
+}
+
+close OUTFILE;
@@ -0,0 +1,83 @@
+#!/usr/bin/perl
+#!/usr/local/bin/perl
+
+$out_filename = "realloc3.rep";
+$num_iters = 64;
+$guard_size = 1000;
+# mm_malloc maps requests of this size or more (MMAP_THRESHOLD in mm.c)
+$mmap_threshold = 131072;
+
+# Each block is grown by reallocs through holes left in the heap by freed
+# blocks, with a guard behind each hole so it cannot grow in place. On its
+# second and third move it is given headroom, so it ends up in a heap block
+# that is larger than its last size and past the mapping threshold. It is
+# then shrunk to a size that is still past the threshold but below its
+# block, grown into a mapping and shrunk again there. The survivors are
+# grown once more at the end, which checks that no copy ran past its
+# mapping.
+@grow = (16384, 40000, 80000, 120000);
+@holes = (40000, 110000, 80000, 80000);
+
+# The driver checks realloc'd data against the id's low byte as a char,
+# so the reallocated blocks take ids below 128 and the others the rest
+$next_id = $num_iters;
+
+for ($i = 0; $i < $num_iters; $i += 1) {
+    $id = $i;
+    @guards = ();
+    push @trace, "a $id $grow[0]";
+    push @guards, $next_id++;
+    push @trace, "a $guards[-1] $guard_size";
+    # the last two holes are next to each other and merge when freed
+    @hole_ids = ();
+    for ($h = 0; $h < @holes; $h += 1) {
+        push @hole_ids, $next_id++;
+        push @trace, "a $hole_ids[-1] $holes[$h]";
+        if ($h != 2) {
+            push @guards, $next_id++;
+            push @trace, "a $guards[-1] $guard_size";
+        }
+    }
+    foreach $hole (@hole_ids) {
+        push @trace, "f $hole";
+    }
+    for ($j = 1; $j < @grow; $j += 1) {
+        push @trace, "r $id $grow[$j]";
+    }
+    push @trace, "r $id " . ($mmap_threshold + int(rand 4096));
+    push @trace, "r $id " . (2*$mmap_threshold);
+    push @trace, "r $id " . ($mmap_threshold / 2);
+    foreach $guard (@guards) {
+        push @trace, "f $guard";
+    }
+    if ($i % 4 == 3) {
+        push @trace, "f $id";
+    } else {
+        push @live, $id;
+    }
+}
+foreach $id (@live) {
+    push @trace, "r $id " . ($mmap_threshold / 2 + 4096);
+}
+foreach $id (@live) {
+    push @trace, "f $id";
+}
+
+# Open output file
+open OUTFILE, ">$out_filename" or die "Cannot create $out_filename\n";
+
+# Calculate misc parameters
+$suggested_heap_size = $num_iters * 2*$mmap_threshold + 100;
+$num_blocks = $next_id;
+$num_ops = @trace;
+
+print OUTFILE "$suggested_heap_size\n";
+print OUTFILE "$num_blocks\n";
+print OUTFILE "$num_ops\n";
+print OUTFILE "1\n";
+
+foreach $op (@trace) {
+    print OUTFILE "$op\n";
+}
+
+close OUTFILE;